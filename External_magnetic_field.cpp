@@ -1,9 +1,13 @@
 #include "External_magnetic_field.h"
 
-External_magnetic_field::External_magnetic_field( Config &conf )
+External_magnetic_field::External_magnetic_field( Config &conf, Spatial_mesh &spat_mesh ) :
+    magnetic_field_on_mesh( nullptr )
 {
     check_correctness_of_related_config_fields( conf );
     get_values_from_config( conf );    
+    if( !magnetic_field_mesh_filename.empty() ){
+	read_magnetic_field_mesh( spat_mesh );
+    }
 }
 
 void External_magnetic_field::check_correctness_of_related_config_fields( Config &conf )
@@ -17,13 +21,139 @@ void External_magnetic_field::get_values_from_config( Config &conf )
 				 conf.external_magnetic_field_config_part.magnetic_field_y,
 				 conf.external_magnetic_field_config_part.magnetic_field_z );
     speed_of_light = conf.external_magnetic_field_config_part.speed_of_light;
+    magnetic_field_mesh_filename =
+	conf.external_magnetic_field_mesh_config_part.magnetic_field_mesh_filename;
+}
+
+void External_magnetic_field::read_magnetic_field_mesh( Spatial_mesh &spat_mesh )
+{
+    x_n_nodes = spat_mesh.x_n_nodes;
+    y_n_nodes = spat_mesh.y_n_nodes;
+    z_n_nodes = spat_mesh.z_n_nodes;
+    x_cell_size = spat_mesh.x_cell_size;
+    y_cell_size = spat_mesh.y_cell_size;
+    z_cell_size = spat_mesh.z_cell_size;
+
+    MPI_Comm_split_type( PETSC_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+			 MPI_INFO_NULL, &node_comm );
+    int node_rank;
+    MPI_Comm_rank( node_comm, &node_rank );
+    MPI_Aint n_of_values = 3 * (MPI_Aint)x_n_nodes * y_n_nodes * z_n_nodes;
+    MPI_Aint local_size = ( node_rank == 0 ) ? n_of_values * sizeof( double ) : 0;
+    double *local_base;
+    MPI_Win_allocate_shared( local_size, sizeof( double ), MPI_INFO_NULL,
+			     node_comm, &local_base, &node_window );
+    MPI_Aint size;
+    int disp_unit;
+    double *field;
+    MPI_Win_shared_query( node_window, 0, &size, &disp_unit, &field );
+
+    MPI_Win_fence( 0, node_window );
+    if( node_rank == 0 ){
+	read_magnetic_field_mesh_from_file( field );
+    }
+    MPI_Win_fence( 0, node_window );
+    magnetic_field_on_mesh = field;
 }
 
-Vec3d External_magnetic_field::force_on_particle( Particle &p )
+void External_magnetic_field::read_magnetic_field_mesh_from_file( double *field )
 {
-    double scale = p.charge / p.mass / speed_of_light;
+    herr_t status;
+    hid_t file_id = H5Fopen( magnetic_field_mesh_filename.c_str(),
+			     H5F_ACC_RDONLY, H5P_DEFAULT );
+    if( file_id < 0 ){
+	std::cout << "Error: can't open magnetic field mesh file "
+		  << magnetic_field_mesh_filename << ". Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    std::string hdf5_groupname = "/Magnetic_field_mesh";
+    hid_t group_id = H5Gopen2( file_id, hdf5_groupname.c_str(), H5P_DEFAULT );
+    hdf5_status_check( group_id );
+
+    int nx, ny, nz;
+    status = H5LTget_attribute_int( group_id, "./", "x_n_nodes", &nx );
+    hdf5_status_check( status );
+    status = H5LTget_attribute_int( group_id, "./", "y_n_nodes", &ny );
+    hdf5_status_check( status );
+    status = H5LTget_attribute_int( group_id, "./", "z_n_nodes", &nz );
+    hdf5_status_check( status );
+    if( nx != x_n_nodes || ny != y_n_nodes || nz != z_n_nodes ){
+	std::cout << "Error: magnetic field mesh in file doesn't match "
+		  << "spatial mesh defined in config. Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    // Each component is read directly into every third element
+    // of the interleaved array, without temporary copies.
+    hsize_t n_of_nodes = (hsize_t)nx * ny * nz;
+    hsize_t memory_size = 3 * n_of_nodes;
+    hid_t memspace = H5Screate_simple( 1, &memory_size, NULL );
+    hdf5_status_check( memspace );
+    const char *names[3] = { "./magnetic_field_x", "./magnetic_field_y", "./magnetic_field_z" };
+    for( int c = 0; c < 3; c++ ){
+	hid_t dset = H5Dopen2( group_id, names[c], H5P_DEFAULT ); hdf5_status_check( dset );
+	hid_t filespace = H5Dget_space( dset ); hdf5_status_check( filespace );
+	if( H5Sget_simple_extent_npoints( filespace ) != (hssize_t)n_of_nodes ){
+	    std::cout << "Error: wrong size of dataset " << names[c]
+		      << " in magnetic field mesh file. Aborting." << std::endl;
+	    exit( EXIT_FAILURE );
+	}
+	hsize_t start = c, stride = 3;
+	status = H5Sselect_hyperslab( memspace, H5S_SELECT_SET,
+				      &start, &stride, &n_of_nodes, NULL );
+	hdf5_status_check( status );
+	status = H5Dread( dset, H5T_NATIVE_DOUBLE, memspace, filespace, H5P_DEFAULT, field );
+	hdf5_status_check( status );
+	status = H5Sclose( filespace ); hdf5_status_check( status );
+	status = H5Dclose( dset ); hdf5_status_check( status );
+    }
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+    status = H5Gclose( group_id ); hdf5_status_check( status );
+    status = H5Fclose( file_id ); hdf5_status_check( status );
+}
+
+Vec3d External_magnetic_field::field_at_particle( Particle_array &particles, size_t i )
+{
+    if( !on_mesh() )
+	return magnetic_field;
+
+    // Same weighting as for the electric field
+    double xg = particles.x[i] / x_cell_size;
+    double yg = particles.y[i] / y_cell_size;
+    double zg = particles.z[i] / z_cell_size;
+    int tlf_i = ceil( xg );
+    int tlf_j = ceil( yg );
+    int tlf_k = ceil( zg );
+    double wx = 1.0 - ( tlf_i - xg );
+    double wy = 1.0 - ( tlf_j - yg );
+    double wz = 1.0 - ( tlf_k - zg );
+    // tlf, trf, blf, brf, tln, trn, bln, brn; same order as in Particle_pusher
+    double bx = 0.0, by = 0.0, bz = 0.0;
+    for( int c = 0; c < 8; c++ ){
+	int di = c & 1;
+	int dj = ( c >> 1 ) & 1;
+	int dk = ( c >> 2 ) & 1;
+	double weight_x = di ? 1.0 - wx : wx;
+	double weight_y = dj ? 1.0 - wy : wy;
+	double weight_z = dk ? 1.0 - wz : wz;
+	size_t node = ( (size_t)( tlf_i - di ) * y_n_nodes + ( tlf_j - dj ) )
+	    * z_n_nodes + ( tlf_k - dk );
+	const double *b = magnetic_field_on_mesh + 3 * node;
+	bx += b[0] * weight_x * weight_y * weight_z;
+	by += b[1] * weight_x * weight_y * weight_z;
+	bz += b[2] * weight_x * weight_y * weight_z;
+    }
+    return vec3d_init( vec3d_x( magnetic_field ) + bx,
+		       vec3d_y( magnetic_field ) + by,
+		       vec3d_z( magnetic_field ) + bz );
+}
+
+Vec3d External_magnetic_field::force_on_particle( Particle_array &particles, size_t i )
+{
+    double scale = particles.charge / particles.mass / speed_of_light;
     
-    return vec3d_times_scalar( vec3d_cross_product( p.momentum, magnetic_field ),
+    return vec3d_times_scalar( vec3d_cross_product( particles.momentum( i ),
+						    field_at_particle( particles, i ) ),
 			       scale );
 }
 
@@ -52,15 +182,29 @@ void External_magnetic_field::write_to_file( hid_t hdf5_file_id )
     status = H5LTset_attribute_double( hdf5_file_id, hdf5_groupname.c_str(),
 				       "speed_of_light", &speed_of_light, single_element );
     hdf5_status_check( status );
+    if( on_mesh() ){
+	status = H5LTset_attribute_string( hdf5_file_id, hdf5_groupname.c_str(),
+					   "magnetic_field_mesh_filename",
+					   magnetic_field_mesh_filename.c_str() );
+	hdf5_status_check( status );
+    }
     
     status = H5Gclose(group_id); hdf5_status_check( status );
     return;
 }
 
+External_magnetic_field::~External_magnetic_field()
+{
+    if( on_mesh() ){
+	MPI_Win_free( &node_window );
+	MPI_Comm_free( &node_comm );
+    }
+}
+
 void External_magnetic_field::hdf5_status_check( herr_t status )
 {
     if( status < 0 ){
-	std::cout << "Something went wrong while writing External_magnetic_field group."
+	std::cout << "Something went wrong while reading or writing External_magnetic_field."
 		  << "Aborting." << std::endl;
 	exit( EXIT_FAILURE );
     }
@@ -6,23 +6,42 @@
 #include <hdf5.h>
 #include <hdf5_hl.h>
 #include <mpi.h>
+#include <string>
 #include "config.h"
-#include "particle.h"
+#include "spatial_mesh.h"
+#include "particle_array.h"
 #include "vec3d.h"
 
+// Uniform magnetic field, optionally with a spatially varying part
+// given on the nodes of Spatial_mesh.
+// The mesh part is stored in the same layout as Spatial_mesh::electric_field,
+// so it can be interpolated together with the electric field.
+// It is read once per node into MPI shared memory: all processes
+// of the node use a single copy.
 class External_magnetic_field
 {
 public:
     Vec3d magnetic_field;
     double speed_of_light;
+    std::string magnetic_field_mesh_filename;
+    // nullptr if there is no mesh part
+    const double *magnetic_field_on_mesh;
 public:    
-    External_magnetic_field( Config &conf );
-    Vec3d force_on_particle( Particle &p );
+    External_magnetic_field( Config &conf, Spatial_mesh &spat_mesh );
+    bool on_mesh() const { return magnetic_field_on_mesh != nullptr; };
+    Vec3d field_at_particle( Particle_array &particles, size_t i );
+    Vec3d force_on_particle( Particle_array &particles, size_t i );
     void write_to_file( hid_t hdf5_file_id );
-    virtual ~External_magnetic_field() {};
+    virtual ~External_magnetic_field();
 private:
+    int x_n_nodes, y_n_nodes, z_n_nodes;
+    double x_cell_size, y_cell_size, z_cell_size;
+    MPI_Comm node_comm;
+    MPI_Win node_window;
     void check_correctness_of_related_config_fields( Config &conf );
     void get_values_from_config( Config &conf );
+    void read_magnetic_field_mesh( Spatial_mesh &spat_mesh );
+    void read_magnetic_field_mesh_from_file( double *field );
     void hdf5_status_check( herr_t status );
 };
 
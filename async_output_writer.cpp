@@ -0,0 +1,97 @@
+#include "async_output_writer.h"
+
+Async_output_writer::Async_output_writer( Config &conf ) :
+    enabled( conf.asynchronous_output_config_part.write_asynchronously ),
+    max_snapshots_in_flight( conf.asynchronous_output_config_part.max_snapshots_in_flight ),
+    io_comm( MPI_COMM_NULL ),
+    snapshots_in_flight( 0 ),
+    stop_requested( false )
+{
+    if( max_snapshots_in_flight < 1 ){
+	std::cout << "Error: max_snapshots_in_flight should be >= 1. Aborting."
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    if( enabled )
+	check_mpi_thread_support();
+    if( enabled )
+	MPI_Comm_dup( PETSC_COMM_WORLD, &io_comm );
+}
+
+void Async_output_writer::check_mpi_thread_support()
+{
+    int provided;
+    MPI_Query_thread( &provided );
+    if( provided < MPI_THREAD_MULTIPLE ){
+	int mpi_process_rank;
+	MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+	if( mpi_process_rank == 0 ){
+	    std::cout << "Warning: MPI library doesn't support MPI_THREAD_MULTIPLE. "
+		      << "Output will be written synchronously." << std::endl;
+	}
+	enabled = false;
+    }
+}
+
+void Async_output_writer::start( std::function<void( Output_snapshot & )> write_snapshot )
+{
+    if( !enabled )
+	return;
+    this->write_snapshot = write_snapshot;
+    io_thread = std::thread( &Async_output_writer::write_queued_snapshots, this );
+}
+
+void Async_output_writer::submit( std::unique_ptr<Output_snapshot> snapshot )
+{
+    std::unique_lock<std::mutex> lock( queue_mutex );
+    queue_changed.wait( lock,
+			[this]{ return snapshots_in_flight < max_snapshots_in_flight; } );
+    queue.push_back( std::move( snapshot ) );
+    snapshots_in_flight++;
+    queue_changed.notify_all();
+}
+
+void Async_output_writer::wait_until_all_written()
+{
+    if( !enabled )
+	return;
+    std::unique_lock<std::mutex> lock( queue_mutex );
+    queue_changed.wait( lock, [this]{ return snapshots_in_flight == 0; } );
+}
+
+void Async_output_writer::write_queued_snapshots()
+{
+    std::unique_ptr<Output_snapshot> snapshot;
+    while( true ){
+	{
+	    std::unique_lock<std::mutex> lock( queue_mutex );
+	    queue_changed.wait( lock, [this]{ return stop_requested || !queue.empty(); } );
+	    if( queue.empty() )
+		return;
+	    snapshot = std::move( queue.front() );
+	    queue.pop_front();
+	}
+	write_snapshot( *snapshot );
+	// staging copies are freed before the slot is released
+	snapshot.reset();
+	{
+	    std::lock_guard<std::mutex> lock( queue_mutex );
+	    snapshots_in_flight--;
+	}
+	queue_changed.notify_all();
+    }
+}
+
+Async_output_writer::~Async_output_writer()
+{
+    if( io_thread.joinable() ){
+	{
+	    std::lock_guard<std::mutex> lock( queue_mutex );
+	    stop_requested = true;
+	}
+	queue_changed.notify_all();
+	io_thread.join();
+    }
+    if( io_comm != MPI_COMM_NULL )
+	MPI_Comm_free( &io_comm );
+}
@@ -0,0 +1,79 @@
+#ifndef _ASYNC_OUTPUT_WRITER_H_
+#define _ASYNC_OUTPUT_WRITER_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <mpi.h>
+#include "config.h"
+#include "time_grid.h"
+#include "spatial_mesh.h"
+#include "particle_array.h"
+#include "particle_source.h"
+
+// Everything that changes between time steps and goes into an output file.
+// Values that require communication between processes
+// ( number of particles at each process, absorbed charge, profile )
+// are evaluated when the snapshot is taken, so the file can be written
+// without any collective calls on PETSC_COMM_WORLD.
+// In synchronous mode pointers refer to the live objects of Domain;
+// in asynchronous mode they refer to the staging copies owned by the snapshot.
+struct Output_snapshot {
+    std::string file_name;
+    MPI_Comm comm;
+    // If not empty, static geometry is kept in this file
+    // and the output file links to it.
+    std::string geometry_file_name;
+    bool write_geometry_file;
+    Time_grid *time_grid;
+    Spatial_mesh *spat_mesh;
+    std::vector<Particle_source_state> particle_sources_state;
+    std::string rest_distribution_rnd_gen_state;
+    std::vector<int> absorbed_particles;
+    std::vector<double> absorbed_charge;
+    bool write_profile;
+    std::vector<double> profile_summary;
+    // Staging copies
+    std::unique_ptr<Time_grid> time_grid_copy;
+    std::unique_ptr<Spatial_mesh> spat_mesh_copy;
+    std::vector<Particle_array> particles_copy;
+};
+
+// Writes output snapshots on a background thread while the main loop continues.
+// Snapshots are written in the order they are submitted;
+// 'submit' blocks while 'max_snapshots_in_flight' snapshots
+// are queued or being written, which caps memory used by staging copies.
+// The thread writes files collectively over its own duplicate of
+// PETSC_COMM_WORLD, so MPI has to provide MPI_THREAD_MULTIPLE;
+// otherwise output falls back to the synchronous mode.
+// HDF5 is called only from the I/O thread once it is started.
+class Async_output_writer {
+  public:
+    bool enabled;
+    int max_snapshots_in_flight;
+    MPI_Comm io_comm;
+  public:
+    Async_output_writer( Config &conf );
+    void start( std::function<void( Output_snapshot & )> write_snapshot );
+    void submit( std::unique_ptr<Output_snapshot> snapshot );
+    void wait_until_all_written();
+    virtual ~Async_output_writer();
+  private:
+    std::function<void( Output_snapshot & )> write_snapshot;
+    std::thread io_thread;
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque< std::unique_ptr<Output_snapshot> > queue;
+    int snapshots_in_flight;
+    bool stop_requested;
+    void check_mpi_thread_support();
+    void write_queued_snapshots();
+};
+
+#endif /* _ASYNC_OUTPUT_WRITER_H_ */
@@ -5,11 +5,13 @@ Config::Config( const std::string &filename )
     try {
 	using boost::property_tree::ptree;
 	ptree pt;
+	ptree signature;
 
 	read_ini(filename, pt);
 	
 	for( auto &sections : pt ) {
 	    std::string section_name = sections.first.data();
+	    add_to_solver_setup_signature( signature, section_name, sections.second );
 	    if ( section_name.find( "Time grid" ) != std::string::npos ) {
 		time_config_part = Time_config_part( sections.second );
 	    } else if ( section_name.find( "Spatial mesh" ) != std::string::npos ) {
@@ -40,16 +42,38 @@ Config::Config( const std::string &filename )
 		    new Inner_region_tube_config_part( inner_region_name, sections.second ) );
 	    } else if ( section_name.find( "Boundary conditions" ) != std::string::npos ) {
 		boundary_config_part = Boundary_config_part( sections.second );
+	    } else if ( section_name.find( "External magnetic field mesh" ) != std::string::npos ) {
+		external_magnetic_field_mesh_config_part =
+		    External_magnetic_field_mesh_config_part( sections.second );
 	    } else if ( section_name.find( "External magnetic field" ) != std::string::npos ) {
 		external_magnetic_field_config_part = External_magnetic_field_config_part( sections.second );
 	    } else if ( section_name.find( "Particle interaction model" ) != std::string::npos ) {
 		particle_interaction_model_config_part = Particle_interaction_model_config_part( sections.second );
+	    } else if ( section_name.find( "Field solver" ) != std::string::npos ) {
+		field_solver_config_part = Field_solver_config_part( sections.second );
+	    } else if ( section_name.find( "Vacuum field" ) != std::string::npos ) {
+		vacuum_field_config_part = Vacuum_field_config_part( sections.second );
+	    } else if ( section_name.find( "Particle pusher" ) != std::string::npos ) {
+		particle_pusher_config_part = Particle_pusher_config_part( sections.second );
+	    } else if ( section_name.find( "Particle sorting" ) != std::string::npos ) {
+		particle_sorting_config_part = Particle_sorting_config_part( sections.second );
+	    } else if ( section_name.find( "Profiling" ) != std::string::npos ) {
+		profiling_config_part = Profiling_config_part( sections.second );
+	    } else if ( section_name.find( "Asynchronous output" ) != std::string::npos ) {
+		asynchronous_output_config_part = Asynchronous_output_config_part( sections.second );
+	    } else if ( section_name.find( "Output layout" ) != std::string::npos ) {
+		output_layout_config_part = Output_layout_config_part( sections.second );
+	    } else if ( section_name.find( "Output compression" ) != std::string::npos ) {
+		output_compression_config_part = Output_compression_config_part( sections.second );
 	    } else if ( section_name.find( "Output filename" ) != std::string::npos ) {
 		output_filename_config_part = Output_filename_config_part( sections.second );				
 	    } else {
 		std::cout << "Ignoring unknown section: " << section_name << std::endl;
 	    }
 	}
+	std::ostringstream signature_stream;
+	write_ini( signature_stream, signature );
+	solver_setup_signature = signature_stream.str();
 	return;
     }
     catch( std::exception& e ) {
@@ -60,3 +84,17 @@ Config::Config( const std::string &filename )
         std::cerr << "Exception of unknown type!\n";
     }
 }
+
+void Config::add_to_solver_setup_signature( boost::property_tree::ptree &signature,
+					    const std::string &section_name,
+					    boost::property_tree::ptree &section )
+{
+    if ( section_name.find( "Spatial mesh" ) != std::string::npos ||
+	 section_name.find( "Field solver" ) != std::string::npos ) {
+	signature.push_back( std::make_pair( section_name, section ) );
+    } else if ( section_name.find( "Inner_region_" ) != std::string::npos ) {
+	boost::property_tree::ptree geometry = section;
+	geometry.erase( "potential" );
+	signature.push_back( std::make_pair( section_name, geometry ) );
+    }
+}
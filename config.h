@@ -6,6 +6,7 @@
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <iostream>
 #include <string>
+#include <sstream>
 #include <limits>
 
 // Too much similar code.
@@ -377,6 +378,22 @@ public:
     }
 };
 
+class External_magnetic_field_mesh_config_part {
+public:
+    std::string magnetic_field_mesh_filename;
+public:
+    External_magnetic_field_mesh_config_part() :
+	magnetic_field_mesh_filename( "" )
+	{};
+    External_magnetic_field_mesh_config_part( boost::property_tree::ptree &ptree ) :
+	magnetic_field_mesh_filename( ptree.get<std::string>("magnetic_field_mesh_filename") )
+	{} ;
+    virtual ~External_magnetic_field_mesh_config_part() {};
+    void print() {
+	std::cout << "magnetic_field_mesh_filename = " << magnetic_field_mesh_filename << std::endl;
+    }
+};
+
 
 class Particle_interaction_model_config_part {
 public:
@@ -393,6 +410,170 @@ public:
 };
 
 
+class Field_solver_config_part {
+public:
+    std::string field_solver;
+public:
+    Field_solver_config_part() :
+	field_solver( "PETSc" )
+	{};
+    Field_solver_config_part( boost::property_tree::ptree &ptree ) :
+	field_solver( ptree.get<std::string>("field_solver") )
+	{} ;
+    virtual ~Field_solver_config_part() {};
+    void print() {
+	std::cout << "Field_solver = " << field_solver << std::endl;
+    }
+};
+
+
+class Vacuum_field_config_part {
+public:
+    std::string vacuum_field_filename;
+public:
+    Vacuum_field_config_part() :
+	vacuum_field_filename( "" )
+	{};
+    Vacuum_field_config_part( boost::property_tree::ptree &ptree ) :
+	vacuum_field_filename( ptree.get<std::string>("vacuum_field_filename") )
+	{} ;
+    virtual ~Vacuum_field_config_part() {};
+    void print() {
+	std::cout << "vacuum_field_filename = " << vacuum_field_filename << std::endl;
+    }
+};
+
+
+class Particle_pusher_config_part {
+public:
+    std::string particle_pusher;
+public:
+    Particle_pusher_config_part() :
+	particle_pusher( "leap_frog" )
+	{};
+    Particle_pusher_config_part( boost::property_tree::ptree &ptree ) :
+	particle_pusher( ptree.get<std::string>("particle_pusher") )
+	{} ;
+    virtual ~Particle_pusher_config_part() {};
+    void print() {
+	std::cout << "Particle_pusher = " << particle_pusher << std::endl;
+    }
+};
+
+
+class Particle_sorting_config_part {
+public:
+    int sort_particles_each_n_steps;
+public:
+    Particle_sorting_config_part() :
+	sort_particles_each_n_steps( 0 )
+	{};
+    Particle_sorting_config_part( boost::property_tree::ptree &ptree ) :
+	sort_particles_each_n_steps( ptree.get<int>("sort_particles_each_n_steps") )
+	{} ;
+    virtual ~Particle_sorting_config_part() {};
+    void print() {
+	std::cout << "sort_particles_each_n_steps = " << sort_particles_each_n_steps << std::endl;
+    }
+};
+
+
+class Profiling_config_part {
+public:
+    int write_profile_each_n_steps;
+public:
+    Profiling_config_part() :
+	write_profile_each_n_steps( 0 )
+	{};
+    Profiling_config_part( boost::property_tree::ptree &ptree ) :
+	write_profile_each_n_steps( ptree.get<int>("write_profile_each_n_steps") )
+	{} ;
+    virtual ~Profiling_config_part() {};
+    void print() {
+	std::cout << "write_profile_each_n_steps = " << write_profile_each_n_steps << std::endl;
+    }
+};
+
+
+class Asynchronous_output_config_part {
+public:
+    bool write_asynchronously;
+    int max_snapshots_in_flight;
+public:
+    Asynchronous_output_config_part() :
+	write_asynchronously( false ),
+	max_snapshots_in_flight( 2 )
+	{};
+    Asynchronous_output_config_part( boost::property_tree::ptree &ptree ) :
+	write_asynchronously( ptree.get<bool>("write_asynchronously") ),
+	max_snapshots_in_flight( ptree.get<int>("max_snapshots_in_flight") )
+	{} ;
+    virtual ~Asynchronous_output_config_part() {};
+    void print() {
+	std::cout << "write_asynchronously = " << write_asynchronously << std::endl;
+	std::cout << "max_snapshots_in_flight = " << max_snapshots_in_flight << std::endl;
+    }
+};
+
+
+class Output_layout_config_part {
+public:
+    std::string output_layout;
+    // Used only by 'time_series' layout;
+    // cache size 0 means room for one chunk
+    int time_series_chunk_steps;
+    int time_series_chunk_cache_size;
+    // On-disk type of mesh fields and particle phase space
+    std::string output_datatype;
+public:
+    Output_layout_config_part() :
+	output_layout( "file_per_step" ),
+	time_series_chunk_steps( 1 ),
+	time_series_chunk_cache_size( 0 ),
+	output_datatype( "float64" )
+	{};
+    Output_layout_config_part( boost::property_tree::ptree &ptree ) :
+	output_layout( ptree.get<std::string>("output_layout") ),
+	time_series_chunk_steps( ptree.get<int>("time_series_chunk_steps", 1) ),
+	time_series_chunk_cache_size(
+	    ptree.get<int>("time_series_chunk_cache_size", 0) ),
+	output_datatype( ptree.get<std::string>("output_datatype", "float64") )
+	{} ;
+    virtual ~Output_layout_config_part() {};
+    void print() {
+	std::cout << "output_layout = " << output_layout << std::endl;
+	std::cout << "time_series_chunk_steps = " << time_series_chunk_steps << std::endl;
+	std::cout << "time_series_chunk_cache_size = " << time_series_chunk_cache_size << std::endl;
+	std::cout << "output_datatype = " << output_datatype << std::endl;
+    }
+};
+
+
+class Output_compression_config_part {
+public:
+    std::string output_compression;
+    int deflate_level;
+    int scale_offset_decimal_digits;
+public:
+    Output_compression_config_part() :
+	output_compression( "none" ),
+	deflate_level( 4 ),
+	scale_offset_decimal_digits( 6 )
+	{};
+    Output_compression_config_part( boost::property_tree::ptree &ptree ) :
+	output_compression( ptree.get<std::string>("output_compression") ),
+	deflate_level( ptree.get<int>("deflate_level", 4) ),
+	scale_offset_decimal_digits( ptree.get<int>("scale_offset_decimal_digits", 6) )
+	{} ;
+    virtual ~Output_compression_config_part() {};
+    void print() {
+	std::cout << "output_compression = " << output_compression << std::endl;
+	std::cout << "deflate_level = " << deflate_level << std::endl;
+	std::cout << "scale_offset_decimal_digits = " << scale_offset_decimal_digits << std::endl;
+    }
+};
+
+
 class Output_filename_config_part {
 public:
     std::string output_filename_prefix;
@@ -418,8 +599,21 @@ public:
     boost::ptr_vector<Inner_region_config_part> inner_regions_config_part;
     Boundary_config_part boundary_config_part;
     External_magnetic_field_config_part external_magnetic_field_config_part;
+    External_magnetic_field_mesh_config_part external_magnetic_field_mesh_config_part;
     Particle_interaction_model_config_part particle_interaction_model_config_part;
+    Field_solver_config_part field_solver_config_part;
+    Vacuum_field_config_part vacuum_field_config_part;
+    Particle_pusher_config_part particle_pusher_config_part;
+    Particle_sorting_config_part particle_sorting_config_part;
+    Profiling_config_part profiling_config_part;
+    Asynchronous_output_config_part asynchronous_output_config_part;
+    Output_layout_config_part output_layout_config_part;
+    Output_compression_config_part output_compression_config_part;
     Output_filename_config_part output_filename_config_part;
+    // Mesh, inner regions geometry and field solver sections
+    // without electrode potentials. Field solver setup can be
+    // reused between configs with equal signatures.
+    std::string solver_setup_signature;
 public:
     Config( const std::string &filename );
     virtual ~Config() {};
@@ -435,10 +629,23 @@ public:
 	}
 	boundary_config_part.print();
 	particle_interaction_model_config_part.print();
+	field_solver_config_part.print();
+	vacuum_field_config_part.print();
+	particle_pusher_config_part.print();
+	particle_sorting_config_part.print();
+	profiling_config_part.print();
+	asynchronous_output_config_part.print();
+	output_layout_config_part.print();
+	output_compression_config_part.print();
 	output_filename_config_part.print();
 	external_magnetic_field_config_part.print();
+	external_magnetic_field_mesh_config_part.print();
 	std::cout << "======" << std::endl;
     }
+private:
+    void add_to_solver_setup_signature( boost::property_tree::ptree &signature,
+					const std::string &section_name,
+					boost::property_tree::ptree &section );
 };
 
 #endif /* _CONFIG_H_ */
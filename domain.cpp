@@ -14,11 +14,111 @@ Domain::Domain( Config &conf ) :
     spat_mesh( conf ),
     inner_regions( conf, spat_mesh ),
     particle_to_mesh_map( ),
-    field_solver( spat_mesh, inner_regions ),
+    field_solver( conf, spat_mesh, inner_regions ),
     particle_sources( conf ),
-    external_magnetic_field( conf ),
-    particle_interaction_model( conf )
+    particle_pusher( conf ),
+    particle_sorter( conf ),
+    external_magnetic_field( conf, spat_mesh ),
+    particle_interaction_model( conf ),
+    profiler( conf ),
+    time_series_output( conf ),
+    async_output_writer( conf ),
+    restarted_from_checkpoint( false ),
+    fields_recomputed_after_restart( false ),
+    charge_density_combined( true ),
+    geometry_in_separate_file( output_layout_from_config( conf ) ),
+    geometry_file_written( false ),
+    output_layout( conf.output_layout_config_part.output_layout ),
+    output_datatype( conf.output_layout_config_part.output_datatype ),
+    output_compression( conf.output_compression_config_part.output_compression )
 {
+    async_output_writer.start(
+	[this]( Output_snapshot &snapshot ){ write_snapshot( snapshot ); } );
+    return;
+}
+
+bool Domain::output_layout_from_config( Config &conf )
+{
+    std::string layout = conf.output_layout_config_part.output_layout;
+    if ( layout == "file_per_step" || layout == "time_series" ){
+	return false;
+    } else if ( layout == "separate_geometry" ){
+	return true;
+    } else {
+	std::cout << "Error: unknown output_layout '" << layout << "'; "
+		  << "expected 'file_per_step', 'separate_geometry' "
+		  << "or 'time_series'." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
+
+void Domain::restart_from_checkpoint( const std::string &checkpoint_file )
+{
+    herr_t status;
+
+    hid_t plist_id;
+    plist_id = H5Pcreate( H5P_FILE_ACCESS ); hdf5_status_check( plist_id );
+    status = H5Pset_fapl_mpio( plist_id, PETSC_COMM_WORLD, MPI_INFO_NULL ); hdf5_status_check( status );
+
+    hid_t checkpoint = H5Fopen( checkpoint_file.c_str(), H5F_ACC_RDONLY, plist_id );
+    if ( negative( checkpoint ) ) {
+	std::cout << "Error: can't open checkpoint file \'" 
+		  << checkpoint_file 
+		  << "\'." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    // Files written before layout was recorded are single steps
+    std::string checkpoint_layout =
+	read_output_format_attribute( checkpoint, "output_layout", "file_per_step" );
+    if ( checkpoint_layout == "time_series" ) {
+	std::cout << "Error: '" << checkpoint_file << "' is a time series file; "
+		  << "restart needs a file of a single step written with "
+		  << "'file_per_step' or 'separate_geometry' output layout."
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    // Time series file is created anew at the first saved step
+    if ( time_series_output.enabled )
+	time_series_output.check_file_does_not_exist();
+
+    int mpi_process_rank;
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
+    if ( read_output_format_attribute( checkpoint, "output_datatype", "float64" )
+	 != "float64" ) {
+	if( mpi_process_rank == 0 ){
+	    std::cout << "Warning: checkpoint '" << checkpoint_file << "' "
+		      << "holds float32 particles and fields; restart is not exact. "
+		      << "Fields are recomputed from restored particles." << std::endl;
+	}
+	fields_recomputed_after_restart = true;
+    }
+    if ( read_output_format_attribute( checkpoint, "output_compression", "none" )
+	 == "scale_offset" ) {
+	if( mpi_process_rank == 0 ){
+	    std::cout << "Warning: checkpoint '" << checkpoint_file << "' "
+		      << "holds potential and fields rounded by scale_offset "
+		      << "compression; restart is not exact. "
+		      << "Fields are recomputed from restored particles." << std::endl;
+	}
+	fields_recomputed_after_restart = true;
+    }
+
+    time_grid.read_from_file( checkpoint );
+    spat_mesh.read_from_file( checkpoint );
+    particle_sources.read_from_file( checkpoint );
+    inner_regions.read_from_file( checkpoint );
+    field_solver.set_initial_guess_from_spat_mesh( spat_mesh );
+
+    if( mpi_process_rank == 0 ){    
+	std::cout << "Restarting from step " << time_grid.current_node 
+		  << " of file " << checkpoint_file << std::endl;
+    }
+
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+    status = H5Fclose( checkpoint ); hdf5_status_check( status );
+
+    restarted_from_checkpoint = true;
     return;
 }
 
@@ -35,8 +135,14 @@ void Domain::run_pic( Config &conf )
     total_time_iterations = time_grid.total_nodes - 1;
     current_node = time_grid.current_node;
 
-    prepare_leap_frog();
-    write_step_to_save( conf );
+    // Checkpoint already holds fields and shifted momenta.
+    // Fields are not recomputed to keep the solver initial guess intact.
+    if ( !restarted_from_checkpoint ){
+	prepare_leap_frog();
+	write_step_to_save( conf );
+    } else if ( fields_recomputed_after_restart ){
+	recompute_fields_after_restart( conf );
+    }
 
     for ( int i = current_node; i < total_time_iterations; i++ ){
 	if ( mpi_process_rank == 0 ){
@@ -47,6 +153,8 @@ void Domain::run_pic( Config &conf )
     	write_step_to_save( conf );
     }
 
+    async_output_writer.wait_until_all_written();
+    profiler.print_report( profile_counters() );
     return;
 }
 
@@ -62,15 +170,34 @@ void Domain::prepare_leap_frog()
     return;
 }
 
+void Domain::recompute_fields_after_restart( Config &conf )
+{
+    // Momenta in checkpoint are already shifted half step back
+    if ( particle_interaction_model.noninteracting ){
+	spat_mesh.clear_old_density_values();
+	if ( conf.vacuum_field_config_part.vacuum_field_filename.empty() ){
+	    eval_potential_and_fields();
+	} else {
+	    read_vacuum_field( conf );
+	}
+    } else if ( particle_interaction_model.pic ){
+	eval_charge_density();
+	eval_potential_and_fields();
+    }
+    return;
+}
+
 void Domain::advance_one_time_step()
 {    
     if ( particle_interaction_model.noninteracting ){
 	push_particles();
 	apply_domain_constrains();
+	sort_particles();
 	update_time_grid();
     } else if ( particle_interaction_model.pic ){
 	push_particles();
 	apply_domain_constrains();
+	sort_particles();
 	eval_charge_density();
 	eval_potential_and_fields();
 	update_time_grid();
@@ -80,23 +207,54 @@ void Domain::advance_one_time_step()
 
 void Domain::eval_charge_density()
 {
+    profiler.start( Profiler::deposition );
     spat_mesh.clear_old_density_values();    
-    particle_to_mesh_map.weight_particles_charge_to_mesh( spat_mesh, particle_sources );
+    particle_to_mesh_map.weight_particles_charge_to_mesh_for_single_process(
+	spat_mesh, particle_sources );
+    profiler.stop( Profiler::deposition );
+
+    charge_density_combined = false;
+    if ( !field_solver.combines_charge_density() )
+	combine_charge_densities();
     
     return;
 }
 
+void Domain::combine_charge_densities()
+{
+    profiler.start( Profiler::density_allreduce );
+    particle_to_mesh_map.combine_charge_densities_from_all_processes( spat_mesh );
+    profiler.stop( Profiler::density_allreduce );
+    charge_density_combined = true;
+    return;
+}
+
 
 void Domain::eval_potential_and_fields()
 {
-    field_solver.eval_potential( spat_mesh, inner_regions );
+    field_solver.eval_potential( spat_mesh, inner_regions, profiler );
+    profiler.start( Profiler::field_gradient );
     field_solver.eval_fields_from_potential( spat_mesh );
+    profiler.stop( Profiler::field_gradient );
+    return;
+}
+
+void Domain::sort_particles()
+{
+    if ( particle_sorter.time_to_sort( time_grid.current_node ) ){
+	profiler.start( Profiler::sorting );
+	particle_sorter.sort( spat_mesh, particle_sources );
+	profiler.stop( Profiler::sorting );
+	particle_sorter.print_locality_counters();
+    }
     return;
 }
 
 void Domain::push_particles()
 {
+    profiler.start( Profiler::push );
     leap_frog();
+    profiler.stop( Profiler::push );
     return;
 }
 
@@ -104,10 +262,13 @@ void Domain::apply_domain_constrains()
 {
     // First generate then remove.
     // This allows for overlap of source and inner region.
+    profiler.start( Profiler::generation );
     generate_new_particles();
+    profiler.stop( Profiler::generation );
 
-    apply_domain_boundary_conditions();
-    remove_particles_inside_inner_regions();    
+    profiler.start( Profiler::particle_removal );
+    remove_particles_out_of_bound_or_inside_inner_regions();
+    profiler.stop( Profiler::particle_removal );
     return;
 }
 
@@ -119,8 +280,9 @@ void Domain::leap_frog()
 {  
     double dt = time_grid.time_step_size;
 
-    update_momentum( dt );
-    update_position( dt );
+    for( auto &src : particle_sources.sources ) {
+	particle_pusher.push( spat_mesh, external_magnetic_field, src.particles, dt );
+    }
     return;
 }
 
@@ -130,83 +292,53 @@ void Domain::shift_velocities_half_time_step_back()
     Vec3d el_field_force, mgn_field_force, total_force, dp;
 
     for( auto &src : particle_sources.sources ) {
-	for( auto &p : src.particles ) {
-	    if ( !p.momentum_is_half_time_step_shifted ){
-		el_field_force = particle_to_mesh_map.force_on_particle( spat_mesh, p );
-		mgn_field_force = external_magnetic_field.force_on_particle( p );
-		total_force = vec3d_add( el_field_force, mgn_field_force );
-		dp = vec3d_times_scalar( total_force, minus_half_dt );
-		p.momentum = vec3d_add( p.momentum, dp );
-		p.momentum_is_half_time_step_shifted = true;
+	Particle_array &particles = src.particles;
+	for( size_t i = 0; i < particles.size(); i++ ) {
+	    if ( !particles.momentum_is_half_time_step_shifted[i] ){
+		el_field_force = particle_to_mesh_map.force_on_particle( spat_mesh, particles, i );
+		if ( particle_pusher.boris ){
+		    particles.set_momentum( i, particle_pusher.boris_momentum_update(
+						particles, i, el_field_force,
+						external_magnetic_field, minus_half_dt ) );
+		} else {
+		    mgn_field_force = external_magnetic_field.force_on_particle( particles, i );
+		    total_force = vec3d_add( el_field_force, mgn_field_force );
+		    dp = vec3d_times_scalar( total_force, minus_half_dt );
+		    particles.set_momentum( i, vec3d_add( particles.momentum( i ), dp ) );
+		}
+		particles.momentum_is_half_time_step_shifted[i] = true;
 	    }
 	}
     }
     return;
 }
 
-void Domain::update_momentum( double dt )
-{
-    Vec3d el_field_force, mgn_field_force, total_force, dp;
-
-    for( auto &src : particle_sources.sources ) {
-	for( auto &p : src.particles ) {
-	    el_field_force = particle_to_mesh_map.force_on_particle( spat_mesh, p );
-	    mgn_field_force = external_magnetic_field.force_on_particle( p );
-	    total_force = vec3d_add( el_field_force, mgn_field_force );
-	    dp = vec3d_times_scalar( total_force, dt );
-	    p.momentum = vec3d_add( p.momentum, dp );
-	}
-    }
-    return;
-}
-
-void Domain::update_position( double dt )
-{
-    particle_sources.update_particles_position( dt );
-    return;
-}
-
 //
 // Apply domain constrains
 //
 
-void Domain::apply_domain_boundary_conditions()
+void Domain::remove_particles_out_of_bound_or_inside_inner_regions()
 {
+    // Single compaction pass per source; particles which left the domain
+    // are not checked against inner regions.
+    // Absorbed charge is summed over processes once for all sources.
     for( auto &src : particle_sources.sources ) {
-    	auto remove_starting_from = std::remove_if( 
-    	    std::begin( src.particles ), 
-    	    std::end( src.particles ), 
-    	    [this]( Particle &p ){ return out_of_bound(p); } ); 
-    	// cout << "Out of bound from " << src.name << ":" << " "
-    	//      << std::end( src.particles ) - remove_starting_from << std::endl;
-    	src.particles.erase(
-    	    remove_starting_from,
-    	    std::end( src.particles ) );
+	Particle_array &particles = src.particles;
+	particles.remove_if(
+	    [this, &particles]( size_t i ){
+		return out_of_bound( particles, i ) ||
+		    inner_regions.check_if_particle_inside_and_count_charge( particles, i );
+	    } );
     }
-
+    inner_regions.sync_absorbed_charge_and_particles_across_proc();
     return;
 }
 
-void Domain::remove_particles_inside_inner_regions()
+bool Domain::out_of_bound( const Particle_array &particles, size_t i )
 {
-    for( auto &src : particle_sources.sources ) {
-	auto remove_starting_from = std::remove_if( 
-	    std::begin( src.particles ), 
-	    std::end( src.particles ), 
-	    [this]( Particle &p ){
-		return inner_regions.check_if_particle_inside_and_count_charge( p );
-	    } ); 
-	inner_regions.sync_absorbed_charge_and_particles_across_proc();
-	src.particles.erase( remove_starting_from, std::end( src.particles ) );
-    }
-    return;
-}
-
-bool Domain::out_of_bound( const Particle &p )
-{
-    double x = vec3d_x( p.position );
-    double y = vec3d_y( p.position );
-    double z = vec3d_z( p.position );
+    double x = particles.x[i];
+    double y = particles.y[i];
+    double z = particles.z[i];
     bool out;
     
     out = 
@@ -245,32 +377,105 @@ void Domain::write_step_to_save( Config &conf )
     int current_step = time_grid.current_node;
     int step_to_save = time_grid.node_to_save;
     if ( ( current_step % step_to_save ) == 0 ){	
+	profiler.start( Profiler::hdf5_write );
 	write( conf );
+	profiler.stop( Profiler::hdf5_write );
     }
     return;
 }
 
 void Domain::write( Config &conf )
 {    
-    herr_t status;
-    
     std::string output_filename_prefix = 
 	conf.output_filename_config_part.output_filename_prefix;
     std::string output_filename_suffix = 
 	conf.output_filename_config_part.output_filename_suffix;
-    std::string file_name_to_write;
-    
-    file_name_to_write = construct_output_filename( output_filename_prefix, 
-						    time_grid.current_node,
-						    output_filename_suffix  );
+
+    std::unique_ptr<Output_snapshot> snapshot( new Output_snapshot );
+    if( time_series_output.enabled ){
+	snapshot->file_name = time_series_output.file_name;
+    } else {
+	snapshot->file_name = construct_output_filename( output_filename_prefix, 
+							 time_grid.current_node,
+							 output_filename_suffix  );
+    }
+    snapshot->write_geometry_file = false;
+    if( geometry_in_separate_file ){
+	snapshot->geometry_file_name =
+	    output_filename_prefix + "geometry" + output_filename_suffix;
+	snapshot->write_geometry_file = !geometry_file_written;
+	geometry_file_written = true;
+    }
+    if( async_output_writer.enabled ){
+	snapshot->comm = async_output_writer.io_comm;
+	take_snapshot( *snapshot, true );
+	async_output_writer.submit( std::move( snapshot ) );
+    } else {
+	snapshot->comm = PETSC_COMM_WORLD;
+	take_snapshot( *snapshot, false );
+	write_snapshot( *snapshot );
+    }
+    return;
+}
+
+void Domain::take_snapshot( Output_snapshot &snapshot, bool make_staging_copies )
+{
+    // Density is combined only for output if field solver doesn't need it
+    if ( !charge_density_combined )
+	combine_charge_densities();
+
+    snapshot.time_grid = &time_grid;
+    snapshot.spat_mesh = &spat_mesh;
+    if( make_staging_copies ){
+	snapshot.time_grid_copy.reset( new Time_grid( time_grid ) );
+	snapshot.spat_mesh_copy.reset( new Spatial_mesh( spat_mesh ) );
+	snapshot.time_grid = snapshot.time_grid_copy.get();
+	snapshot.spat_mesh = snapshot.spat_mesh_copy.get();
+	snapshot.particles_copy.reserve( particle_sources.sources.size() );
+    }
+
+    snapshot.particle_sources_state = particle_sources.current_state();
+    snapshot.rest_distribution_rnd_gen_state =
+	particle_sources.rest_distribution_rnd_gen_state();
+    if( make_staging_copies ){
+	for( auto &state : snapshot.particle_sources_state ){
+	    snapshot.particles_copy.push_back( *state.particles );
+	    state.particles = &snapshot.particles_copy.back();
+	}
+    }
+
+    for( auto &reg : inner_regions.regions ){
+	snapshot.absorbed_particles.push_back( reg.total_absorbed_particles );
+	snapshot.absorbed_charge.push_back( reg.total_absorbed_charge );
+    }
+
+    snapshot.write_profile = profiler.time_to_write( time_grid.current_node );
+    if( snapshot.write_profile ){
+	snapshot.profile_summary =
+	    profiler.summary_over_processes( profile_counters() );
+    }
+    return;
+}
+
+void Domain::write_snapshot( Output_snapshot &snapshot )
+{
+    herr_t status;
+
+    if( time_series_output.enabled ){
+	append_snapshot_to_time_series( snapshot );
+	return;
+    }
+    if( snapshot.write_geometry_file )
+	write_geometry_file( snapshot );
+
     hid_t plist_id;
     plist_id = H5Pcreate( H5P_FILE_ACCESS ); hdf5_status_check( plist_id );
-    status = H5Pset_fapl_mpio( plist_id, MPI_COMM_WORLD, MPI_INFO_NULL ); hdf5_status_check( status );
+    status = H5Pset_fapl_mpio( plist_id, snapshot.comm, MPI_INFO_NULL ); hdf5_status_check( status );
 
-    hid_t output_file = H5Fcreate( file_name_to_write.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id );
+    hid_t output_file = H5Fcreate( snapshot.file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id );
     if ( negative( output_file ) ) {
 	std::cout << "Error: can't open file \'" 
-		  << file_name_to_write 
+		  << snapshot.file_name 
 		  << "\' to save results of simulation!" 
 		  << std::endl;
 	std::cout << "Recheck \'output_filename_prefix\' key in config file." 
@@ -281,18 +486,30 @@ void Domain::write( Config &conf )
     }
 
     int mpi_process_rank;
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_rank( snapshot.comm, &mpi_process_rank );    
     if( mpi_process_rank == 0 ){    
-	std::cout << "Writing step " << time_grid.current_node 
-		  << " to file " << file_name_to_write << std::endl;
+	std::cout << "Writing step " << snapshot.time_grid->current_node 
+		  << " to file " << snapshot.file_name << std::endl;
     }
 
-    time_grid.write_to_file( output_file );
-    spat_mesh.write_to_file( output_file );
-    external_magnetic_field.write_to_file( output_file );
-    particle_sources.write_to_file( output_file );
-    inner_regions.write_to_file( output_file );
-    particle_interaction_model.write_to_file( output_file );
+    write_output_format_attributes( output_file );
+    snapshot.time_grid->write_to_file( output_file );
+    if( snapshot.geometry_file_name.empty() ){
+	snapshot.spat_mesh->write_to_file( output_file );
+	external_magnetic_field.write_to_file( output_file );
+    } else {
+	link_geometry_file( output_file, snapshot );
+    }
+    particle_sources.write_to_file( output_file, snapshot.particle_sources_state,
+				    snapshot.rest_distribution_rnd_gen_state );
+    inner_regions.write_to_file( output_file,
+				 snapshot.absorbed_particles,
+				 snapshot.absorbed_charge );
+    if( snapshot.geometry_file_name.empty() )
+	particle_interaction_model.write_to_file( output_file );
+    if( snapshot.write_profile ){
+	profiler.write_to_file( output_file, snapshot.profile_summary );
+    }
 
     status = H5Pclose( plist_id ); hdf5_status_check( status );
     status = H5Fclose( output_file ); hdf5_status_check( status );
@@ -300,6 +517,96 @@ void Domain::write( Config &conf )
     return;
 }
 
+void Domain::append_snapshot_to_time_series( Output_snapshot &snapshot )
+{
+    herr_t status;
+
+    if( !time_series_output.is_open() ){
+	time_series_output.create( snapshot.comm );
+	write_output_format_attributes( time_series_output.file_id );
+	external_magnetic_field.write_to_file( time_series_output.file_id );
+	particle_interaction_model.write_to_file( time_series_output.file_id );
+    }
+
+    int mpi_process_rank;
+    MPI_Comm_rank( snapshot.comm, &mpi_process_rank );    
+    if( mpi_process_rank == 0 ){    
+	std::cout << "Writing step " << snapshot.time_grid->current_node 
+		  << " to file " << snapshot.file_name << std::endl;
+    }
+
+    snapshot.time_grid->append_to_time_series( time_series_output );
+    snapshot.spat_mesh->append_to_time_series( time_series_output );
+
+    hid_t step_group_id =
+	time_series_output.create_step_group( snapshot.time_grid->current_node );
+    particle_sources.write_to_file( step_group_id, snapshot.particle_sources_state,
+				    snapshot.rest_distribution_rnd_gen_state );
+    inner_regions.write_to_file( step_group_id,
+				 snapshot.absorbed_particles,
+				 snapshot.absorbed_charge );
+    if( snapshot.write_profile ){
+	profiler.write_to_file( step_group_id, snapshot.profile_summary );
+    }
+    status = H5Gclose( step_group_id ); hdf5_status_check( status );
+
+    time_series_output.finish_step();
+    return;
+}
+
+void Domain::write_geometry_file( Output_snapshot &snapshot )
+{
+    herr_t status;
+
+    hid_t plist_id;
+    plist_id = H5Pcreate( H5P_FILE_ACCESS ); hdf5_status_check( plist_id );
+    status = H5Pset_fapl_mpio( plist_id, snapshot.comm, MPI_INFO_NULL ); hdf5_status_check( status );
+
+    hid_t geometry_file = H5Fcreate( snapshot.geometry_file_name.c_str(), H5F_ACC_TRUNC,
+				     H5P_DEFAULT, plist_id );
+    if ( negative( geometry_file ) ) {
+	std::cout << "Error: can't open file \'" 
+		  << snapshot.geometry_file_name 
+		  << "\' to save geometry of simulation!" 
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    int mpi_process_rank;
+    MPI_Comm_rank( snapshot.comm, &mpi_process_rank );    
+    if( mpi_process_rank == 0 ){    
+	std::cout << "Writing geometry to file " << snapshot.geometry_file_name << std::endl;
+    }
+
+    snapshot.spat_mesh->write_geometry_to_file( geometry_file );
+    external_magnetic_field.write_to_file( geometry_file );
+    particle_interaction_model.write_to_file( geometry_file );
+
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+    status = H5Fclose( geometry_file ); hdf5_status_check( status );
+    return;
+}
+
+void Domain::link_geometry_file( hid_t output_file, Output_snapshot &snapshot )
+{
+    herr_t status;
+    // Files are written next to each other;
+    // HDF5 looks for linked file in the directory of the linking one.
+    std::string geometry_file_name = snapshot.geometry_file_name;
+    size_t last_slash = geometry_file_name.find_last_of( '/' );
+    if( last_slash != std::string::npos )
+	geometry_file_name = geometry_file_name.substr( last_slash + 1 );
+
+    snapshot.spat_mesh->write_to_file_linking_geometry( output_file, geometry_file_name );
+    const char *groups[] = { "/External_magnetic_field", "/Particle_interaction_model" };
+    for( auto &group : groups ){
+	status = H5Lcreate_external( geometry_file_name.c_str(), group,
+				     output_file, group, H5P_DEFAULT, H5P_DEFAULT );
+	hdf5_status_check( status );
+    }
+    return;
+}
+
 
 std::string construct_output_filename( const std::string output_filename_prefix, 
 				       const int current_time_step,
@@ -337,10 +644,19 @@ void Domain::print_particles()
 
 void Domain::eval_and_write_fields_without_particles( Config &conf )
 {
-    herr_t status;
-
     spat_mesh.clear_old_density_values();
-    eval_potential_and_fields();
+    if ( conf.vacuum_field_config_part.vacuum_field_filename.empty() ){
+	eval_potential_and_fields();
+    } else {
+	read_vacuum_field( conf );
+    }
+    write_fields_without_particles( conf );
+    return;
+}
+
+void Domain::write_fields_without_particles( Config &conf )
+{
+    herr_t status;
 
     std::string output_filename_prefix = 
 	conf.output_filename_config_part.output_filename_prefix;
@@ -354,7 +670,7 @@ void Domain::eval_and_write_fields_without_particles( Config &conf )
 
     hid_t plist_id;
     plist_id = H5Pcreate( H5P_FILE_ACCESS ); hdf5_status_check( plist_id );
-    status = H5Pset_fapl_mpio( plist_id, MPI_COMM_WORLD, MPI_INFO_NULL ); hdf5_status_check( status );
+    status = H5Pset_fapl_mpio( plist_id, PETSC_COMM_WORLD, MPI_INFO_NULL ); hdf5_status_check( status );
 
     hid_t output_file = H5Fcreate( file_name_to_write.c_str(),
 				   H5F_ACC_TRUNC, H5P_DEFAULT, plist_id );
@@ -371,12 +687,13 @@ void Domain::eval_and_write_fields_without_particles( Config &conf )
     }
 
     int mpi_process_rank;
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
     if( mpi_process_rank == 0 ){    
 	std::cout << "Writing initial fields" << " "
 		  << "to file " << file_name_to_write << std::endl;
     }
     
+    write_output_format_attributes( output_file );
     spat_mesh.write_to_file( output_file );
     inner_regions.write_to_file( output_file );
 
@@ -386,6 +703,111 @@ void Domain::eval_and_write_fields_without_particles( Config &conf )
     return;
 }
 
+void Domain::read_vacuum_field( Config &conf )
+{
+    herr_t status;
+    std::string vacuum_field_file = conf.vacuum_field_config_part.vacuum_field_filename;
+
+    if ( !particle_interaction_model.noninteracting ){
+	std::cout << "Error: 'vacuum_field_filename' can be used only with "
+		  << "noninteracting particles. Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    hid_t plist_id;
+    plist_id = H5Pcreate( H5P_FILE_ACCESS ); hdf5_status_check( plist_id );
+    status = H5Pset_fapl_mpio( plist_id, PETSC_COMM_WORLD, MPI_INFO_NULL ); hdf5_status_check( status );
+
+    hid_t vacuum_field = H5Fopen( vacuum_field_file.c_str(), H5F_ACC_RDONLY, plist_id );
+    if ( negative( vacuum_field ) ) {
+	std::cout << "Error: can't open vacuum field file \'" 
+		  << vacuum_field_file
+		  << "\'." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    if ( read_output_format_attribute( vacuum_field, "output_layout", "file_per_step" )
+	 == "time_series" ) {
+	std::cout << "Error: vacuum field file '" << vacuum_field_file
+		  << "' is a time series file. Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    int mpi_process_rank;
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
+    if ( read_output_format_attribute( vacuum_field, "output_datatype", "float64" )
+	 != "float64" && mpi_process_rank == 0 ) {
+	std::cout << "Warning: vacuum field file '" << vacuum_field_file << "' "
+		  << "holds float32 fields; particles are pushed "
+		  << "by rounded fields." << std::endl;
+    }
+    if ( read_output_format_attribute( vacuum_field, "output_compression", "none" )
+	 == "scale_offset" ) {
+	std::cout << "Error: vacuum field file '" << vacuum_field_file << "' "
+		  << "holds potential and fields rounded by scale_offset "
+		  << "compression; write it with 'none' or 'deflate' "
+		  << "output_compression. Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    if( mpi_process_rank == 0 ){    
+	std::cout << "Reading fields without particles "
+		  << "from file " << vacuum_field_file << std::endl;
+    }
+
+    spat_mesh.read_from_file( vacuum_field );
+    spat_mesh.clear_old_density_values();
+
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+    status = H5Fclose( vacuum_field ); hdf5_status_check( status );
+    return;
+}
+
+void Domain::write_output_format_attributes( hid_t hdf5_file_id )
+{
+    herr_t status;
+    status = H5LTset_attribute_string( hdf5_file_id, "/",
+				       "output_layout", output_layout.c_str() );
+    hdf5_status_check( status );
+    status = H5LTset_attribute_string( hdf5_file_id, "/",
+				       "output_datatype", output_datatype.c_str() );
+    hdf5_status_check( status );
+    status = H5LTset_attribute_string( hdf5_file_id, "/",
+				       "output_compression", output_compression.c_str() );
+    hdf5_status_check( status );
+    return;
+}
+
+std::string Domain::read_output_format_attribute( hid_t hdf5_file_id, const char *name,
+						  const std::string &value_if_absent )
+{
+    herr_t status;
+    htri_t exists = H5Aexists_by_name( hdf5_file_id, "/", name, H5P_DEFAULT );
+    hdf5_status_check( exists );
+    if ( !exists )
+	return value_if_absent;
+
+    hsize_t dims;
+    H5T_class_t type_class;
+    size_t type_size;
+    status = H5LTget_attribute_info( hdf5_file_id, "/", name,
+				     &dims, &type_class, &type_size );
+    hdf5_status_check( status );
+    std::vector<char> value( type_size + 1, '\0' );
+    status = H5LTget_attribute_string( hdf5_file_id, "/", name, value.data() );
+    hdf5_status_check( status );
+    return std::string( value.data() );
+}
+
+std::vector<double> Domain::profile_counters()
+{
+    std::vector<double> counters( Profiler::n_of_counters, 0.0 );
+    for( auto &src : particle_sources.sources ){
+	counters[Profiler::particles] += src.particles.size();
+	counters[Profiler::particle_reallocations] += src.particles.n_of_reallocations;
+	counters[Profiler::particle_storage_peak_bytes] += src.particles.peak_memory();
+    }
+    return counters;
+}
+
 bool Domain::negative( hid_t hdf5_id )
 {
     return hdf5_id < 0;
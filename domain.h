@@ -18,7 +18,12 @@
 #include "External_magnetic_field.h"
 #include "particle_interaction_model.h"
 #include "particle_source.h"
-#include "particle.h"
+#include "particle_pusher.h"
+#include "particle_sorter.h"
+#include "profiler.h"
+#include "async_output_writer.h"
+#include "time_series_output.h"
+#include "particle_array.h"
 #include "vec3d.h"
 
 //#define M_PI 3.14159265358979323846264338327
@@ -33,36 +38,76 @@ class Domain {
     Particle_to_mesh_map particle_to_mesh_map;
     Field_solver field_solver;    
     Particle_sources_manager particle_sources;
+    Particle_pusher particle_pusher;
+    Particle_sorter particle_sorter;
     External_magnetic_field external_magnetic_field;
     Particle_interaction_model particle_interaction_model;
+    Profiler profiler;
+    // Closes the file after async_output_writer has written all snapshots.
+    Time_series_output time_series_output;
+    // Last member: destroyed first, so pending snapshots are written
+    // while the rest of the domain is still alive.
+    Async_output_writer async_output_writer;
+  private:
+    bool restarted_from_checkpoint;
+    // Checkpoint holds rounded fields; they are evaluated anew
+    // from restored particles before the first step.
+    bool fields_recomputed_after_restart;
+    bool charge_density_combined;
+    // 'separate_geometry' output layout: node coordinates, magnetic field
+    // and interaction model are written once to a geometry file.
+    bool geometry_in_separate_file;
+    bool geometry_file_written;
+    // Stored as '/' attribute of output files;
+    // files with 'time_series' layout can't be used for restart.
+    std::string output_layout;
+    // 'float32' output can't be used for exact restart
+    std::string output_datatype;
+    // 'scale_offset' potential and fields are rounded as well
+    std::string output_compression;
   public:
     Domain( Config &conf );
+    // Continue simulation from a file written by 'write';
+    // config and number of processes have to be the same.
+    void restart_from_checkpoint( const std::string &checkpoint_file );
     void run_pic( Config &conf );
     void eval_and_write_fields_without_particles( Config &conf );
+    void read_vacuum_field( Config &conf );
+    void write_fields_without_particles( Config &conf );
     void write_step_to_save( Config &conf );
     void write( Config &conf );
+    void take_snapshot( Output_snapshot &snapshot, bool make_staging_copies );
+    void write_snapshot( Output_snapshot &snapshot );
+    void append_snapshot_to_time_series( Output_snapshot &snapshot );
+    void write_geometry_file( Output_snapshot &snapshot );
+    void link_geometry_file( hid_t output_file, Output_snapshot &snapshot );
+    bool output_layout_from_config( Config &conf );
     virtual ~Domain();
   private:
     // Pic algorithm
     void prepare_leap_frog();
+    void recompute_fields_after_restart( Config &conf );
     void advance_one_time_step();
     void eval_charge_density();
+    void combine_charge_densities();
     void eval_potential_and_fields();
     void push_particles();
     void apply_domain_constrains();
-    void remove_particles_inside_inner_regions();
+    void remove_particles_out_of_bound_or_inside_inner_regions();
     void update_time_grid();
+    void sort_particles();
     // Push particles
     void leap_frog();
     void shift_velocities_half_time_step_back();
-    void update_momentum( double dt );
-    void update_position( double dt );
     // Boundaries and generation
-    void apply_domain_boundary_conditions();
-    bool out_of_bound( const Particle &p );
+    bool out_of_bound( const Particle_array &particles, size_t i );
     void generate_new_particles();    
     // Various functions
     void print_particles();
+    std::vector<double> profile_counters();
+    void write_output_format_attributes( hid_t hdf5_file_id );
+    std::string read_output_format_attribute( hid_t hdf5_file_id, const char *name,
+					      const std::string &value_if_absent );
     bool negative( hid_t hdf5_id );
     void hdf5_status_check( herr_t status );
 };
@@ -0,0 +1,65 @@
+#include "ensemble_batch.h"
+
+Ensemble_batch::Ensemble_batch( const std::vector<std::string> &all_config_files,
+				int group_num, int n_of_groups )
+{
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+    std::vector<size_t> order = order_by_solver_setup_signature( all_config_files );
+    size_t n_of_configs = all_config_files.size();
+    size_t first = n_of_configs * group_num / n_of_groups;
+    size_t last = n_of_configs * ( group_num + 1 ) / n_of_groups;
+    for( size_t i = first; i < last; i++ )
+	config_files.push_back( all_config_files[ order[i] ] );
+}
+
+std::vector<size_t> Ensemble_batch::order_by_solver_setup_signature(
+    const std::vector<std::string> &all_config_files )
+{
+    // Signatures are numbered in order of first appearance;
+    // configs with equal signatures keep their relative order.
+    std::map<std::string, size_t> signature_num;
+    std::vector<size_t> config_signature_num;
+    for( auto &config_file : all_config_files ){
+	Config conf( config_file );
+	auto inserted = signature_num.insert(
+	    std::make_pair( conf.solver_setup_signature, signature_num.size() ) );
+	config_signature_num.push_back( inserted.first->second );
+    }
+    std::vector<size_t> order( all_config_files.size() );
+    for( size_t i = 0; i < order.size(); i++ )
+	order[i] = i;
+    std::stable_sort( order.begin(), order.end(),
+		      [&config_signature_num]( size_t a, size_t b ) {
+			  return config_signature_num[a] < config_signature_num[b]; } );
+    return order;
+}
+
+void Ensemble_batch::run()
+{
+    for( size_t i = 0; i < config_files.size(); i++ ){
+	if( mpi_process_rank == 0 ){
+	    std::cout << "Batch run " << i + 1 << " of " << config_files.size()
+		      << ": " << config_files[i] << std::endl;
+	}
+	run_config( config_files[i] );
+    }
+}
+
+void Ensemble_batch::run_config( const std::string &config_file )
+{
+    Config conf( config_file );
+    if( mpi_process_rank == 0 )
+	conf.print();
+    // Each run starts as a separate one would.
+    Particle_source::rest_distribution_rnd_gen.seed();
+
+    Domain dom( conf );
+    if( field_solver && field_solver_signature == conf.solver_setup_signature )
+	dom.field_solver.take_over_setup( *field_solver );
+    dom.eval_and_write_fields_without_particles( conf );
+    dom.run_pic( conf );
+
+    field_solver.reset( new Field_solver( conf, dom.spat_mesh, dom.inner_regions ) );
+    field_solver->take_over_setup( dom.field_solver );
+    field_solver_signature = conf.solver_setup_signature;
+}
@@ -0,0 +1,42 @@
+#ifndef _ENSEMBLE_BATCH_H_
+#define _ENSEMBLE_BATCH_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <algorithm>
+#include <mpi.h>
+#include <petscsys.h>
+#include "config.h"
+#include "field_solver.h"
+#include "particle_source.h"
+#include "domain.h"
+
+// Runs several config files in a single MPI job.
+// Processes are split into groups, each with its own PETSC_COMM_WORLD.
+// Field solver setup is passed from one run to the next
+// if their configs have equal solver setup signatures,
+// i.e. the same mesh, inner regions geometry and field solver.
+// To make use of it, configs are ordered so that equal signatures
+// are consecutive, and each group runs a contiguous block
+// of this list, one config after another.
+class Ensemble_batch {
+  public:
+    std::vector<std::string> config_files;
+  public:
+    Ensemble_batch( const std::vector<std::string> &all_config_files,
+		    int group_num, int n_of_groups );
+    void run();
+    virtual ~Ensemble_batch() {};
+  private:
+    int mpi_process_rank;
+    std::unique_ptr<Field_solver> field_solver;
+    std::string field_solver_signature;
+    std::vector<size_t> order_by_solver_setup_signature(
+	const std::vector<std::string> &all_config_files );
+    void run_config( const std::string &config_file );
+};
+
+#endif /* _ENSEMBLE_BATCH_H_ */
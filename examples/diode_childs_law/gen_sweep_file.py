@@ -0,0 +1,8 @@
+voltages = list( range(10, 1511, 50) )
+volts_to_cgs = 1.0 / 300.0
+
+with open( 'voltages.sweep', 'w') as f:
+    f.write( "output_filename_prefix anode\n" )
+    for V in voltages:
+        f.write( "V" + "{0:0=4d}".format(V) + "_ " + \
+                 "{0:.5f}".format(V * volts_to_cgs ) + "\n" )
@@ -0,0 +1,3 @@
+python3 gen_sweep_file.py
+../../ef.out diode_childs_law.conf --sweep voltages.sweep
+python3 plot.py
@@ -0,0 +1,280 @@
+#include "fast_poisson_solver.h"
+
+Fast_poisson_solver::Fast_poisson_solver( Spatial_mesh &spat_mesh )
+{
+    n1 = spat_mesh.x_n_nodes - 2;
+    n2 = spat_mesh.y_n_nodes - 2;
+    n3 = spat_mesh.z_n_nodes - 2;
+    dx = spat_mesh.x_cell_size;
+    dy = spat_mesh.y_cell_size;
+    dz = spat_mesh.z_cell_size;
+
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+
+    split_into_slabs( n1, i_slab_start, i_slab_size );
+    split_into_slabs( n2, j_slab_start, j_slab_size );
+    init_transpose_counts();
+
+    // Plans are created with FFTW_MEASURE, which overwrites the arrays,
+    // so they are allocated before anything is stored in them.
+    i_slab = (double *) fftw_malloc( sizeof(double) * std::max( local_i_slab_size(), (size_t)1 ) );
+    j_slab = (double *) fftw_malloc( sizeof(double) * std::max( local_j_slab_size(), (size_t)1 ) );
+    create_plans();
+
+    eval_eigenvalues( eigenvalues_x, n1, dx );
+    eval_eigenvalues( eigenvalues_y, n2, dy );
+    eval_eigenvalues( eigenvalues_z, n3, dz );
+}
+
+void Fast_poisson_solver::split_into_slabs( int n,
+					    std::vector<int> &start,
+					    std::vector<int> &size )
+{
+    start.resize( mpi_n_of_proc );
+    size.resize( mpi_n_of_proc );
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	start[proc] = (long)n * proc / mpi_n_of_proc;
+	size[proc] = (long)n * ( proc + 1 ) / mpi_n_of_proc - start[proc];
+    }
+}
+
+void Fast_poisson_solver::init_transpose_counts()
+{
+    int ni = i_slab_size[ mpi_process_rank ];
+    int nj = j_slab_size[ mpi_process_rank ];
+
+    i_to_j_send_counts.resize( mpi_n_of_proc );
+    i_to_j_send_displs.resize( mpi_n_of_proc );
+    i_to_j_recv_counts.resize( mpi_n_of_proc );
+    i_to_j_recv_displs.resize( mpi_n_of_proc );
+    gather_counts.resize( mpi_n_of_proc );
+    gather_displs.resize( mpi_n_of_proc );
+    int send_displ = 0, recv_displ = 0;
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	i_to_j_send_counts[proc] = ni * j_slab_size[proc] * n3;
+	i_to_j_send_displs[proc] = send_displ;
+	send_displ += i_to_j_send_counts[proc];
+	i_to_j_recv_counts[proc] = i_slab_size[proc] * nj * n3;
+	i_to_j_recv_displs[proc] = recv_displ;
+	recv_displ += i_to_j_recv_counts[proc];
+	gather_counts[proc] = i_slab_size[proc] * n2 * n3;
+	gather_displs[proc] = i_slab_start[proc] * n2 * n3;
+    }
+    send_buffer.resize( std::max( send_displ, recv_displ ) );
+    recv_buffer.resize( std::max( send_displ, recv_displ ) );
+    gathered_solution.resize( (size_t)n1 * n2 * n3 );
+}
+
+void Fast_poisson_solver::create_plans()
+{
+    int ni = i_slab_size[ mpi_process_rank ];
+    int nj = j_slab_size[ mpi_process_rank ];
+    fftw_r2r_kind dst[2] = { FFTW_RODFT00, FFTW_RODFT00 };
+
+    dst_yz = NULL;
+    if( ni > 0 && n2 > 0 && n3 > 0 ){
+	fftw_iodim yz_dims[2] = { { n2, n3, n3 }, { n3, 1, 1 } };
+	fftw_iodim slabs[1] = { { ni, n2 * n3, n2 * n3 } };
+	dst_yz = fftw_plan_guru_r2r( 2, yz_dims, 1, slabs,
+				     i_slab, i_slab, dst, FFTW_MEASURE );
+    }
+
+    dst_x = NULL;
+    if( nj > 0 && n1 > 0 && n3 > 0 ){
+	fftw_iodim x_dims[1] = { { n1, n3, n3 } };
+	fftw_iodim slabs_and_z[2] = { { nj, n1 * n3, n1 * n3 }, { n3, 1, 1 } };
+	dst_x = fftw_plan_guru_r2r( 1, x_dims, 2, slabs_and_z,
+				    j_slab, j_slab, dst, FFTW_MEASURE );
+    }
+}
+
+void Fast_poisson_solver::eval_eigenvalues( std::vector<double> &eigenvalues,
+					    int n, double h )
+{
+    // Eigenvalues of 1D second difference operator with zero
+    // boundary values; eigenvectors are sin( pi * m * i / ( n + 1 ) ).
+    eigenvalues.resize( n );
+    for( int m = 0; m < n; m++ ){
+	eigenvalues[m] = -2.0 / ( h * h ) * ( 1.0 - cos( M_PI * ( m + 1 ) / ( n + 1 ) ) );
+    }
+}
+
+
+void Fast_poisson_solver::solve( Spatial_mesh &spat_mesh )
+{
+    if( n1 <= 0 || n2 <= 0 || n3 <= 0 )
+	return;
+
+    init_rhs_in_i_slab( spat_mesh );
+    if( dst_yz )
+	fftw_execute( dst_yz );
+    transpose_i_slabs_to_j_slabs();
+    if( dst_x )
+	fftw_execute( dst_x );
+    divide_by_eigenvalues_in_j_slab();
+    if( dst_x )
+	fftw_execute( dst_x );
+    transpose_j_slabs_to_i_slabs();
+    if( dst_yz )
+	fftw_execute( dst_yz );
+}
+
+void Fast_poisson_solver::init_rhs_in_i_slab( Spatial_mesh &spat_mesh )
+{
+    // Same as right hand side of the PETSc solver,
+    // but without multiplication by dx^2 * dy^2 * dz^2.
+    int nx = spat_mesh.x_n_nodes;
+    int ny = spat_mesh.y_n_nodes;
+    int nz = spat_mesh.z_n_nodes;
+    double cx = 1.0 / ( dx * dx );
+    double cy = 1.0 / ( dy * dy );
+    double cz = 1.0 / ( dz * dz );
+    int i_start = i_slab_start[ mpi_process_rank ];
+    int ni = i_slab_size[ mpi_process_rank ];
+
+    for( int il = 0; il < ni; il++ ){
+	int i = i_start + il + 1;
+	for( int j = 1; j <= ny - 2; j++ ){
+	    for( int k = 1; k <= nz - 2; k++ ){
+		double rhs_at_node = -4.0 * M_PI * spat_mesh.charge_density[i][j][k];
+		if( i == 1 ) rhs_at_node -= cx * spat_mesh.potential[0][j][k];
+		if( i == nx - 2 ) rhs_at_node -= cx * spat_mesh.potential[nx-1][j][k];
+		if( j == 1 ) rhs_at_node -= cy * spat_mesh.potential[i][0][k];
+		if( j == ny - 2 ) rhs_at_node -= cy * spat_mesh.potential[i][ny-1][k];
+		if( k == 1 ) rhs_at_node -= cz * spat_mesh.potential[i][j][0];
+		if( k == nz - 2 ) rhs_at_node -= cz * spat_mesh.potential[i][j][nz-1];
+		i_slab[ ( (size_t)il * n2 + ( j - 1 ) ) * n3 + ( k - 1 ) ] = rhs_at_node;
+	    }
+	}
+    }
+}
+
+void Fast_poisson_solver::transpose_i_slabs_to_j_slabs()
+{
+    int ni = i_slab_size[ mpi_process_rank ];
+    int nj = j_slab_size[ mpi_process_rank ];
+    size_t row_bytes = sizeof(double) * n3;
+
+    // Block for process 'proc' is [i_local][j of proc][k]
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	double *block = send_buffer.data() + i_to_j_send_displs[proc];
+	for( int il = 0; il < ni; il++ )
+	    for( int jl = 0; jl < j_slab_size[proc]; jl++ ){
+		int j = j_slab_start[proc] + jl;
+		memcpy( block + ( (size_t)il * j_slab_size[proc] + jl ) * n3,
+			i_slab + ( (size_t)il * n2 + j ) * n3, row_bytes );
+	    }
+    }
+
+    MPI_Alltoallv( send_buffer.data(), i_to_j_send_counts.data(),
+		   i_to_j_send_displs.data(), MPI_DOUBLE,
+		   recv_buffer.data(), i_to_j_recv_counts.data(),
+		   i_to_j_recv_displs.data(), MPI_DOUBLE, PETSC_COMM_WORLD );
+
+    // Block from process 'proc' is [i of proc][j_local][k]
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	const double *block = recv_buffer.data() + i_to_j_recv_displs[proc];
+	for( int il = 0; il < i_slab_size[proc]; il++ ){
+	    int i = i_slab_start[proc] + il;
+	    for( int jl = 0; jl < nj; jl++ ){
+		memcpy( j_slab + ( (size_t)jl * n1 + i ) * n3,
+			block + ( (size_t)il * nj + jl ) * n3, row_bytes );
+	    }
+	}
+    }
+}
+
+void Fast_poisson_solver::transpose_j_slabs_to_i_slabs()
+{
+    int ni = i_slab_size[ mpi_process_rank ];
+    int nj = j_slab_size[ mpi_process_rank ];
+    size_t row_bytes = sizeof(double) * n3;
+
+    // Reverse of 'transpose_i_slabs_to_j_slabs':
+    // counts and displacements of send and receive are swapped.
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	double *block = send_buffer.data() + i_to_j_recv_displs[proc];
+	for( int il = 0; il < i_slab_size[proc]; il++ ){
+	    int i = i_slab_start[proc] + il;
+	    for( int jl = 0; jl < nj; jl++ ){
+		memcpy( block + ( (size_t)il * nj + jl ) * n3,
+			j_slab + ( (size_t)jl * n1 + i ) * n3, row_bytes );
+	    }
+	}
+    }
+
+    MPI_Alltoallv( send_buffer.data(), i_to_j_recv_counts.data(),
+		   i_to_j_recv_displs.data(), MPI_DOUBLE,
+		   recv_buffer.data(), i_to_j_send_counts.data(),
+		   i_to_j_send_displs.data(), MPI_DOUBLE, PETSC_COMM_WORLD );
+
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	const double *block = recv_buffer.data() + i_to_j_send_displs[proc];
+	for( int il = 0; il < ni; il++ )
+	    for( int jl = 0; jl < j_slab_size[proc]; jl++ ){
+		int j = j_slab_start[proc] + jl;
+		memcpy( i_slab + ( (size_t)il * n2 + j ) * n3,
+			block + ( (size_t)il * j_slab_size[proc] + jl ) * n3, row_bytes );
+	    }
+    }
+}
+
+void Fast_poisson_solver::divide_by_eigenvalues_in_j_slab()
+{
+    // Unnormalized DST-I applied twice along an axis with n nodes
+    // multiplies data by 2 * ( n + 1 ).
+    double normalization = 1.0 / ( 8.0 * ( n1 + 1 ) * ( n2 + 1 ) * ( n3 + 1 ) );
+    int j_start = j_slab_start[ mpi_process_rank ];
+    int nj = j_slab_size[ mpi_process_rank ];
+
+    for( int jl = 0; jl < nj; jl++ ){
+	double lambda_y = eigenvalues_y[ j_start + jl ];
+	for( int i = 0; i < n1; i++ ){
+	    double lambda_xy = eigenvalues_x[i] + lambda_y;
+	    double *row = j_slab + ( (size_t)jl * n1 + i ) * n3;
+	    for( int k = 0; k < n3; k++ ){
+		row[k] *= normalization / ( lambda_xy + eigenvalues_z[k] );
+	    }
+	}
+    }
+}
+
+void Fast_poisson_solver::transfer_solution_to_spat_mesh( Spatial_mesh &spat_mesh )
+{
+    if( n1 <= 0 || n2 <= 0 || n3 <= 0 )
+	return;
+
+    MPI_Allgatherv( i_slab, gather_counts[ mpi_process_rank ], MPI_DOUBLE,
+		    gathered_solution.data(), gather_counts.data(), gather_displs.data(),
+		    MPI_DOUBLE, PETSC_COMM_WORLD );
+
+    size_t n = 0;
+    for( int i = 1; i <= n1; i++ ){
+	for( int j = 1; j <= n2; j++ ){
+	    for( int k = 1; k <= n3; k++ ){
+		spat_mesh.potential[i][j][k] = gathered_solution[ n++ ];
+	    }
+	}
+    }
+}
+
+size_t Fast_poisson_solver::local_i_slab_size()
+{
+    return (size_t)i_slab_size[ mpi_process_rank ] * n2 * n3;
+}
+
+size_t Fast_poisson_solver::local_j_slab_size()
+{
+    return (size_t)j_slab_size[ mpi_process_rank ] * n1 * n3;
+}
+
+Fast_poisson_solver::~Fast_poisson_solver()
+{
+    if( dst_yz )
+	fftw_destroy_plan( dst_yz );
+    if( dst_x )
+	fftw_destroy_plan( dst_x );
+    fftw_free( i_slab );
+    fftw_free( j_slab );
+}
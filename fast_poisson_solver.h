@@ -0,0 +1,59 @@
+#ifndef _FAST_POISSON_SOLVER_H_
+#define _FAST_POISSON_SOLVER_H_
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mpi.h>
+#include <fftw3.h>
+#include "spatial_mesh.h"
+
+// Direct solver for Poisson equation in a box with Dirichlet boundaries
+// and without inner regions.
+// Discrete sine transform (DST-I) diagonalizes the 7-point Laplacian
+// on the interior nodes; boundary potentials are moved to the right
+// hand side. Solution is exact up to round-off and costs O(N log N).
+// Work is split between processes in slabs: 2D transforms along y and z
+// are done on slabs of constant x, then the data is transposed
+// into slabs of constant y for transforms along x.
+// Whole solution is gathered at each process, as for other solvers.
+class Fast_poisson_solver {
+  public:
+    Fast_poisson_solver( Spatial_mesh &spat_mesh );
+    void solve( Spatial_mesh &spat_mesh );
+    void transfer_solution_to_spat_mesh( Spatial_mesh &spat_mesh );
+    virtual ~Fast_poisson_solver();
+  private:
+    // Number of interior nodes along each axis
+    int n1, n2, n3;
+    double dx, dy, dz;
+    int mpi_n_of_proc, mpi_process_rank;
+    // Slabs of constant x ( 'i' ) and of constant y ( 'j' ) for each process.
+    // Layout of x-slab is [i_local][j][k], of y-slab is [j_local][i][k].
+    std::vector<int> i_slab_start, i_slab_size;
+    std::vector<int> j_slab_start, j_slab_size;
+    double *i_slab, *j_slab;
+    fftw_plan dst_yz, dst_x;
+    std::vector<double> eigenvalues_x, eigenvalues_y, eigenvalues_z;
+    std::vector<double> send_buffer, recv_buffer;
+    std::vector<int> i_to_j_send_counts, i_to_j_send_displs;
+    std::vector<int> i_to_j_recv_counts, i_to_j_recv_displs;
+    std::vector<double> gathered_solution;
+    std::vector<int> gather_counts, gather_displs;
+    // Init
+    void split_into_slabs( int n, std::vector<int> &start, std::vector<int> &size );
+    void init_transpose_counts();
+    void create_plans();
+    void eval_eigenvalues( std::vector<double> &eigenvalues, int n, double h );
+    // Solve
+    void init_rhs_in_i_slab( Spatial_mesh &spat_mesh );
+    void transpose_i_slabs_to_j_slabs();
+    void transpose_j_slabs_to_i_slabs();
+    void divide_by_eigenvalues_in_j_slab();
+    size_t local_i_slab_size();
+    size_t local_j_slab_size();
+};
+
+#endif /* _FAST_POISSON_SOLVER_H_ */
@@ -1,7 +1,60 @@
 #include "field_solver.h"
 
-Field_solver::Field_solver( Spatial_mesh &spat_mesh,
-			    Inner_regions_manager &inner_regions )
+Field_solver::Field_solver( Config &conf,
+			    Spatial_mesh &spat_mesh,
+			    Inner_regions_manager &inner_regions ) :
+    solver_initialized( false ),
+    initial_guess_from_spat_mesh_pending( false )
+{
+    check_correctness_of_related_config_fields( conf );
+    field_solver_type = conf.field_solver_config_part.field_solver;
+    // Plain Dirichlet box is solved directly regardless of 'field_solver'
+    use_fast_poisson_solver = inner_regions.regions.empty();
+}
+
+void Field_solver::init_solver( Spatial_mesh &spat_mesh,
+				Inner_regions_manager &inner_regions )
+{
+    if( solver_initialized )
+	return;
+    if( use_fast_poisson_solver ){
+	fast_poisson_solver.reset( new Fast_poisson_solver( spat_mesh ) );
+    } else if( field_solver_type == "multigrid" ){
+	multigrid_solver.reset(
+	    new Multigrid_poisson_solver( spat_mesh, inner_regions ) );
+    } else {
+	init_petsc_solver( spat_mesh, inner_regions );
+    }
+    solver_initialized = true;
+    if( initial_guess_from_spat_mesh_pending ){
+	set_initial_guess_from_spat_mesh( spat_mesh );
+	initial_guess_from_spat_mesh_pending = false;
+    }
+}
+
+void Field_solver::check_correctness_of_related_config_fields( Config &conf )
+{
+    std::string solver = conf.field_solver_config_part.field_solver;
+    if( solver != "PETSc" && solver != "multigrid" ){
+	std::cout << "Error: wrong value of 'field_solver': " + solver << std::endl;
+	std::cout << "Allowed values : 'PETSc', 'multigrid'" << std::endl;
+	std::cout << "Aborting" << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
+
+bool Field_solver::petsc_solver_used()
+{
+    return !use_fast_poisson_solver && field_solver_type != "multigrid";
+}
+
+bool Field_solver::combines_charge_density()
+{
+    return petsc_solver_used();
+}
+
+void Field_solver::init_petsc_solver( Spatial_mesh &spat_mesh,
+				      Inner_regions_manager &inner_regions )
 {
     int nx = spat_mesh.x_n_nodes;
     int ny = spat_mesh.y_n_nodes;
@@ -19,6 +72,7 @@ Field_solver::Field_solver( Spatial_mesh &spat_mesh,
     alloc_petsc_vector( &phi_vec, nrows, "Solution" );
     ierr = VecSet( phi_vec, 0.0 ); CHKERRXX( ierr );
     get_vector_ownership_range_and_local_size_for_each_process( &phi_vec, &rstart, &rend, &nlocal );
+    gather_ownership_ranges_of_all_processes( nrows );
     alloc_petsc_vector( &rhs, nrows, "RHS" );
 
     alloc_petsc_matrix( &A, nlocal, nlocal, nrows, ncols, A_approx_nonzero_per_row );
@@ -448,24 +502,49 @@ void Field_solver::create_solver_and_preconditioner( KSP *ksp, PC *pc, Mat *A )
 }
 
 void Field_solver::eval_potential( Spatial_mesh &spat_mesh,
-				   Inner_regions_manager &inner_regions )
-{
-    solve_poisson_eqn( spat_mesh, inner_regions );
+				   Inner_regions_manager &inner_regions,
+				   Profiler &profiler )
+{
+    init_solver( spat_mesh, inner_regions );
+    if( fast_poisson_solver ){
+	profiler.start( Profiler::field_solve );
+	fast_poisson_solver->solve( spat_mesh );
+	profiler.stop( Profiler::field_solve );
+	profiler.start( Profiler::solution_transfer );
+	fast_poisson_solver->transfer_solution_to_spat_mesh( spat_mesh );
+	profiler.stop( Profiler::solution_transfer );
+    } else if( multigrid_solver ){
+	// Solution is obtained directly in spat_mesh.potential
+	profiler.start( Profiler::field_solve );
+	multigrid_solver->solve( spat_mesh, inner_regions );
+	profiler.stop( Profiler::field_solve );
+    } else {
+	solve_poisson_eqn( spat_mesh, inner_regions, profiler );
+    }
 }
 
 void Field_solver::solve_poisson_eqn( Spatial_mesh &spat_mesh,
-				      Inner_regions_manager &inner_regions )
+				      Inner_regions_manager &inner_regions,
+				      Profiler &profiler )
 {
     PetscErrorCode ierr;
 
+    profiler.start( Profiler::density_allreduce );
+    reduce_scatter_charge_density( spat_mesh );
+    profiler.stop( Profiler::density_allreduce );
+
+    profiler.start( Profiler::field_solve );
     init_rhs_vector( spat_mesh, inner_regions );    
     ierr = KSPSolve( ksp, rhs, phi_vec); CHKERRXX( ierr );
     
     // This should be done in 'cross_out_nodes_occupied_by_objects' by
     // MatZeroRows function but it seems it doesn't work
     set_solution_at_nodes_of_inner_regions( spat_mesh, inner_regions );
-    
+    profiler.stop( Profiler::field_solve );
+
+    profiler.start( Profiler::solution_transfer );
     transfer_solution_to_spat_mesh( spat_mesh );
+    profiler.stop( Profiler::solution_transfer );
     
     return;
 }
@@ -482,6 +561,25 @@ void Field_solver::init_rhs_vector( Spatial_mesh &spat_mesh,
     modify_rhs_near_object_boundaries( spat_mesh, inner_regions );
 }
 
+void Field_solver::reduce_scatter_charge_density( Spatial_mesh &spat_mesh )
+{
+    int nx = spat_mesh.x_n_nodes;
+    int ny = spat_mesh.y_n_nodes;
+    int nz = spat_mesh.z_n_nodes;
+
+    // Same order of nodes as in node_ijk_to_global_index_in_matrix
+    int global_index = 0;
+    for( int k = 1; k <= nz - 2; k++ ){
+	for( int j = 1; j <= ny - 2; j++ ){
+	    for( int i = 1; i <= nx - 2; i++ ){
+		rho_in_matrix_order[ global_index++ ] = spat_mesh.charge_density[i][j][k];
+	    }
+	}
+    }
+    MPI_Reduce_scatter( rho_in_matrix_order.data(), rho_at_owned_rows.data(),
+			phi_recvcounts.data(), MPI_DOUBLE, MPI_SUM, PETSC_COMM_WORLD );
+}
+
 void Field_solver::init_rhs_vector_in_full_domain( Spatial_mesh &spat_mesh )
 {
     PetscErrorCode ierr;
@@ -494,40 +592,34 @@ void Field_solver::init_rhs_vector_in_full_domain( Spatial_mesh &spat_mesh )
     double dy = spat_mesh.y_cell_size;
     double dz = spat_mesh.z_cell_size;
     double rhs_at_node;
-
-    // todo: split into separate functions
-    for ( int k = 1; k <= nz-2; k++ ) {
-	for ( int j = 1; j <= ny-2; j++ ) { 
-	    for ( int i = 1; i <= nx-2; i++ ) {
-		// - 4 * pi * rho * dx^2 * dy^2
-		rhs_at_node = -4.0 * M_PI * spat_mesh.charge_density[i][j][k];
-		rhs_at_node = rhs_at_node * dx * dx * dy * dy * dz * dz;
-		// left and right boundary
-		rhs_at_node = rhs_at_node
-		    - dy * dy * dz * dz *
-		    ( kronecker_delta(i,1) * spat_mesh.potential[0][j][k] +
-		      kronecker_delta(i,nx-2) * spat_mesh.potential[nx-1][j][k] );
-		// top and bottom boundary
-		rhs_at_node = rhs_at_node
-		    - dx * dx * dz * dz *
-		    ( kronecker_delta(j,1) * spat_mesh.potential[i][0][k] +
-		      kronecker_delta(j,ny-2) * spat_mesh.potential[i][ny-1][k] );
-		// near and far boundary
-		rhs_at_node = rhs_at_node
-		    - dx * dx * dy * dy *
-		    ( kronecker_delta(k,1) * spat_mesh.potential[i][j][0] +
-		      kronecker_delta(k,nz-2) * spat_mesh.potential[i][j][nz-1] );
-		// set rhs vector values
-		ierr = VecSetValue( rhs,
-				    node_ijk_to_global_index_in_matrix( i, j, k, nx, ny, nz ),
-				    rhs_at_node, INSERT_VALUES );
-		CHKERRXX( ierr );
-	    }
-	}
+    int i, j, k;
+    double *local_rhs_values;
+
+    // Only rows owned by the process are set, from the reduce-scattered density
+    ierr = VecGetArray( rhs, &local_rhs_values ); CHKERRXX( ierr );
+    for ( PetscInt row = rstart; row < rend; row++ ) {
+	global_index_in_matrix_to_node_ijk( row, &i, &j, &k, nx, ny, nz );
+	// - 4 * pi * rho * dx^2 * dy^2
+	rhs_at_node = -4.0 * M_PI * rho_at_owned_rows[ row - rstart ];
+	rhs_at_node = rhs_at_node * dx * dx * dy * dy * dz * dz;
+	// left and right boundary
+	rhs_at_node = rhs_at_node
+	    - dy * dy * dz * dz *
+	    ( kronecker_delta(i,1) * spat_mesh.potential[0][j][k] +
+	      kronecker_delta(i,nx-2) * spat_mesh.potential[nx-1][j][k] );
+	// top and bottom boundary
+	rhs_at_node = rhs_at_node
+	    - dx * dx * dz * dz *
+	    ( kronecker_delta(j,1) * spat_mesh.potential[i][0][k] +
+	      kronecker_delta(j,ny-2) * spat_mesh.potential[i][ny-1][k] );
+	// near and far boundary
+	rhs_at_node = rhs_at_node
+	    - dx * dx * dy * dy *
+	    ( kronecker_delta(k,1) * spat_mesh.potential[i][j][0] +
+	      kronecker_delta(k,nz-2) * spat_mesh.potential[i][j][nz-1] );
+	local_rhs_values[ row - rstart ] = rhs_at_node;
     }
-    
-    ierr = VecAssemblyBegin( rhs ); CHKERRXX( ierr );
-    ierr = VecAssemblyEnd( rhs ); CHKERRXX( ierr );
+    ierr = VecRestoreArray( rhs, &local_rhs_values ); CHKERRXX( ierr );
     
     return;
 }
@@ -757,76 +849,72 @@ void Field_solver::global_index_in_matrix_to_node_ijk( int global_index,
 }
 
 
-void Field_solver::transfer_solution_to_spat_mesh( Spatial_mesh &spat_mesh )
+void Field_solver::gather_ownership_ranges_of_all_processes( PetscInt nrows )
 {
-    int recieved_rstart, recieved_rend, recieved_nlocal;
-    double *local_phi_values;
-
-    int mpi_n_of_proc, mpi_process_rank;
+    int mpi_n_of_proc;
     MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
 
-    MPI_Barrier( PETSC_COMM_WORLD );
-    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
-	bcast_phi_array_size( &recieved_rstart, &recieved_rend, &recieved_nlocal, proc, mpi_process_rank );
-	allocate_and_populate_phi_array( &local_phi_values, recieved_nlocal, proc, mpi_process_rank );
-	transfer_from_phi_array_to_spat_mesh_potential( local_phi_values, recieved_rstart, recieved_rend, spat_mesh );
-	deallocate_phi_array( local_phi_values, proc, mpi_process_rank );
-    }
+    int local_rstart = rstart;
+    int local_nlocal = nlocal;
+    phi_recvcounts.resize( mpi_n_of_proc );
+    phi_displs.resize( mpi_n_of_proc );
+    MPI_Allgather( &local_rstart, 1, MPI_INT,
+		   phi_displs.data(), 1, MPI_INT, PETSC_COMM_WORLD );
+    MPI_Allgather( &local_nlocal, 1, MPI_INT,
+		   phi_recvcounts.data(), 1, MPI_INT, PETSC_COMM_WORLD );
+    phi_global_values.resize( nrows );
+    rho_in_matrix_order.resize( nrows );
+    rho_at_owned_rows.resize( nlocal );
 }
 
-void Field_solver::bcast_phi_array_size( int *recieved_rstart, int *recieved_rend, int *recieved_nlocal,
-					 int proc, int mpi_process_rank )
+void Field_solver::transfer_solution_to_spat_mesh( Spatial_mesh &spat_mesh )
 {
-    if( proc == mpi_process_rank ){
-	*recieved_rstart = rstart;
-	*recieved_rend = rend;
+    int nx = spat_mesh.x_n_nodes;
+    int ny = spat_mesh.y_n_nodes;
+    int nz = spat_mesh.z_n_nodes;
+    PetscErrorCode ierr;
+    double *local_phi_values;
+
+    ierr = VecGetArray( phi_vec, &local_phi_values ); CHKERRXX( ierr );
+    MPI_Allgatherv( local_phi_values, nlocal, MPI_DOUBLE,
+		    phi_global_values.data(), phi_recvcounts.data(), phi_displs.data(),
+		    MPI_DOUBLE, PETSC_COMM_WORLD );
+    ierr = VecRestoreArray( phi_vec, &local_phi_values ); CHKERRXX( ierr );
+
+    // Same order of nodes as in node_ijk_to_global_index_in_matrix
+    int global_index = 0;
+    for( int k = 1; k <= nz - 2; k++ ){
+	for( int j = 1; j <= ny - 2; j++ ){
+	    for( int i = 1; i <= nx - 2; i++ ){
+		spat_mesh.potential[i][j][k] = phi_global_values[ global_index++ ];
+	    }
+	}
     }
-    MPI_Bcast( recieved_rstart, 1, MPI_INT, proc, PETSC_COMM_WORLD );
-    MPI_Bcast( recieved_rend, 1, MPI_INT, proc, PETSC_COMM_WORLD );
-    *recieved_nlocal = *recieved_rend - *recieved_rstart;
-    return;
 }
 
-void Field_solver::allocate_and_populate_phi_array( double **local_phi_values, int recieved_nlocal,
-						    int proc, int mpi_process_rank )
+void Field_solver::set_initial_guess_from_spat_mesh( Spatial_mesh &spat_mesh )
 {
-    PetscErrorCode ierr;
-    if( proc == mpi_process_rank ){
-	ierr = VecGetArray( phi_vec, local_phi_values ); CHKERRXX( ierr );
-    } else {
-	*local_phi_values = new double [recieved_nlocal];
+    // Multigrid works on spat_mesh.potential directly; DST is not iterative.
+    if( !petsc_solver_used() )
+	return;
+    if( !solver_initialized ){
+	initial_guess_from_spat_mesh_pending = true;
+	return;
     }
-    MPI_Bcast( *local_phi_values, recieved_nlocal, MPI_DOUBLE, proc, PETSC_COMM_WORLD );
-}
 
-void Field_solver::transfer_from_phi_array_to_spat_mesh_potential( double *local_phi_values,
-								   int recieved_rstart, int recieved_rend,
-								   Spatial_mesh &spat_mesh )
-{
     int nx = spat_mesh.x_n_nodes;
     int ny = spat_mesh.y_n_nodes;
     int nz = spat_mesh.z_n_nodes;
-    int i,j,k;
-
-    for( int global_index = recieved_rstart; global_index < recieved_rend; global_index++ ){
-	global_index_in_matrix_to_node_ijk( global_index,
-					    &i, &j, &k,
-					    nx, ny, nz );
-	spat_mesh.potential[i][j][k] = local_phi_values[ global_index - recieved_rstart ];
-    }
-    
-}
-
-void Field_solver::deallocate_phi_array( double *local_phi_values, int proc, int mpi_process_rank )
-{
+    int i, j, k;
     PetscErrorCode ierr;
+    double *local_phi_values;
 
-    if( proc == mpi_process_rank ){
-	ierr = VecRestoreArray( phi_vec, &local_phi_values ); CHKERRXX( ierr );
-    } else {
-	delete[] local_phi_values;
-    }		    
+    ierr = VecGetArray( phi_vec, &local_phi_values ); CHKERRXX( ierr );
+    for( PetscInt row = rstart; row < rend; row++ ){
+	global_index_in_matrix_to_node_ijk( row, &i, &j, &k, nx, ny, nz );
+	local_phi_values[ row - rstart ] = spat_mesh.potential[i][j][k];
+    }
+    ierr = VecRestoreArray( phi_vec, &local_phi_values ); CHKERRXX( ierr );
 }
 
 void Field_solver::eval_fields_from_potential( Spatial_mesh &spat_mesh )
@@ -886,11 +974,47 @@ double Field_solver::boundary_difference( double phi1, double phi2, double dx )
 }
 
 
+void Field_solver::take_over_setup( Field_solver &other )
+{
+    if( !other.solver_initialized )
+	return;
+    free_setup();
+    fast_poisson_solver = std::move( other.fast_poisson_solver );
+    multigrid_solver = std::move( other.multigrid_solver );
+    if( petsc_solver_used() ){
+	phi_vec = other.phi_vec;
+	rhs = other.rhs;
+	A = other.A;
+	ksp = other.ksp;
+	pc = other.pc;
+	rstart = other.rstart;
+	rend = other.rend;
+	nlocal = other.nlocal;
+	phi_recvcounts.swap( other.phi_recvcounts );
+	phi_displs.swap( other.phi_displs );
+	phi_global_values.swap( other.phi_global_values );
+	rho_in_matrix_order.swap( other.rho_in_matrix_order );
+	rho_at_owned_rows.swap( other.rho_at_owned_rows );
+    }
+    solver_initialized = true;
+    other.solver_initialized = false;
+}
+
 Field_solver::~Field_solver()
 {    
-    PetscErrorCode ierr;
-    ierr = VecDestroy( &phi_vec ); CHKERRXX( ierr );
-    ierr = VecDestroy( &rhs ); CHKERRXX( ierr );
-    ierr = MatDestroy( &A ); CHKERRXX( ierr );
-    ierr = KSPDestroy( &ksp ); CHKERRXX( ierr );
+    free_setup();
+}
+
+void Field_solver::free_setup()
+{
+    fast_poisson_solver.reset();
+    multigrid_solver.reset();
+    if( petsc_solver_used() && solver_initialized ){
+	PetscErrorCode ierr;
+	ierr = VecDestroy( &phi_vec ); CHKERRXX( ierr );
+	ierr = VecDestroy( &rhs ); CHKERRXX( ierr );
+	ierr = MatDestroy( &A ); CHKERRXX( ierr );
+	ierr = KSPDestroy( &ksp ); CHKERRXX( ierr );
+    }
+    solver_initialized = false;
 }
@@ -6,23 +6,70 @@
 #include <mpi.h>
 #include <boost/multi_array.hpp>
 #include <vector>
+#include <string>
+#include <memory>
+#include "config.h"
 #include "spatial_mesh.h"
 #include "inner_region.h"
+#include "multigrid_poisson_solver.h"
+#include "fast_poisson_solver.h"
+#include "profiler.h"
 
 class Field_solver {
   public:
-    Field_solver( Spatial_mesh &spat_mesh,
+    std::string field_solver_type;
+  public:
+    Field_solver( Config &conf,
+		  Spatial_mesh &spat_mesh,
 		  Inner_regions_manager &inner_regions );
     void eval_potential( Spatial_mesh &spat_mesh,
-			 Inner_regions_manager &inner_regions );
+			 Inner_regions_manager &inner_regions,
+			 Profiler &profiler );
     void eval_fields_from_potential( Spatial_mesh &spat_mesh );
+    // PETSc solver sums charge densities deposited at each process itself,
+    // reduce-scattering them into owned rows of 'rhs';
+    // spat_mesh.charge_density is not combined in this case.
+    bool combines_charge_density();
+    // Iterative solvers start from the previous solution;
+    // on restart it has to be taken from the restored potential.
+    void set_initial_guess_from_spat_mesh( Spatial_mesh &spat_mesh );
+    // Move already built solver (DST plans, multigrid levels or
+    // PETSc matrix and preconditioner) from 'other'.
+    // Both have to be created for the same mesh, inner regions geometry
+    // and config; potentials of electrodes may differ.
+    void take_over_setup( Field_solver &other );
     virtual ~Field_solver();
   private:
+    // Solver is built on the first call to 'eval_potential'.
+    // With noninteracting particles fields are evaluated once
+    // or read from file, so setup may be not needed at all.
+    bool solver_initialized;
+    bool use_fast_poisson_solver;
+    bool initial_guess_from_spat_mesh_pending;
+    // Set only if there are no inner regions.
+    std::unique_ptr<Fast_poisson_solver> fast_poisson_solver;
+    // Set only if 'multigrid' solver is selected.
+    std::unique_ptr<Multigrid_poisson_solver> multigrid_solver;
+    // PETSc objects are created only if none of the above is used.
     Vec phi_vec, rhs;
     Mat A;
     KSP ksp;
     PC pc;
     PetscInt rstart, rend, nlocal;
+    // Ownership ranges of phi_vec on all processes and buffer
+    // for the whole solution; used to gather the solution at each process
+    std::vector<int> phi_recvcounts, phi_displs;
+    std::vector<double> phi_global_values;
+    // Density of interior nodes in order of matrix rows,
+    // deposited at this process and summed over processes for owned rows
+    std::vector<double> rho_in_matrix_order, rho_at_owned_rows;
+    void check_correctness_of_related_config_fields( Config &conf );
+    void init_solver( Spatial_mesh &spat_mesh,
+		      Inner_regions_manager &inner_regions );
+    void free_setup();
+    void init_petsc_solver( Spatial_mesh &spat_mesh,
+			    Inner_regions_manager &inner_regions );
+    bool petsc_solver_used();
     void alloc_petsc_vector( Vec *x, PetscInt size, const char *name );
     void get_vector_ownership_range_and_local_size_for_each_process(
 	Vec *x, PetscInt *rstart, PetscInt *rend, PetscInt *nlocal );
@@ -65,9 +112,11 @@ class Field_solver {
     void construct_d2dz2_in_3d( Mat *d2dz2_3d, int nx, int ny, int nz, PetscInt rstart, PetscInt rend );
     // Solve potential
     void solve_poisson_eqn( Spatial_mesh &spat_mesh,
-			    Inner_regions_manager &inner_regions ); 
+			    Inner_regions_manager &inner_regions,
+			    Profiler &profiler );
     void init_rhs_vector( Spatial_mesh &spat_mesh,
 			  Inner_regions_manager &inner_regions ); 
+    void reduce_scatter_charge_density( Spatial_mesh &spat_mesh );
     void init_rhs_vector_in_full_domain( Spatial_mesh &spat_mesh );
     void set_rhs_at_nodes_occupied_by_objects( Spatial_mesh &spat_mesh,
 					       Inner_regions_manager &inner_regions ); 
@@ -94,15 +143,8 @@ class Field_solver {
     void global_index_in_matrix_to_node_ijk( int global_index,
 					     int *i, int *j, int *k,
 					     int nx, int ny, int nz );
+    void gather_ownership_ranges_of_all_processes( PetscInt nrows );
     void transfer_solution_to_spat_mesh( Spatial_mesh &spat_mesh );
-    void bcast_phi_array_size( int *recieved_rstart, int *recieved_rend, int *recieved_nlocal,
-			       int proc, int mpi_process_rank );
-    void allocate_and_populate_phi_array( double **local_phi_values, int recieved_nlocal,
-					  int proc, int mpi_process_rank );
-    void transfer_from_phi_array_to_spat_mesh_potential( double *local_phi_values,
-							 int recieved_rstart, int recieved_rend,
-							 Spatial_mesh &spat_mesh );
-    void deallocate_phi_array( double *local_phi_values, int proc, int mpi_process_rank );
     // Eval fields from potential
     double boundary_difference( double phi1, double phi2, double dx );
     double central_difference( double phi1, double phi2, double dx );
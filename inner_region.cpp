@@ -25,25 +25,28 @@ void Inner_region::get_values_from_config( Inner_region_config_part &inner_regio
 }
 
 
-bool Inner_region::check_if_particle_inside( Particle &p )
+bool Inner_region::check_if_particle_inside( Particle_array &particles, size_t i )
 {
-    double px = vec3d_x( p.position );
-    double py = vec3d_y( p.position );
-    double pz = vec3d_z( p.position );
-    return check_if_point_inside( px, py, pz );
+    return check_if_point_inside( particles.x[i], particles.y[i], particles.z[i] );
 }
 
-bool Inner_region::check_if_particle_inside_and_count_charge( Particle &p )
+bool Inner_region::check_if_particle_inside_and_count_charge( Particle_array &particles,
+							      size_t i )
 {
     bool in_or_out;
-    in_or_out = check_if_particle_inside( p );
+    in_or_out = check_if_particle_inside( particles, i );
     if( in_or_out ){
-	absorbed_particles_current_timestep_current_proc++;
-	absorbed_charge_current_timestep_current_proc += p.charge;
+	count_absorbed_particle( particles );
     }
     return in_or_out;
 }
 
+void Inner_region::count_absorbed_particle( Particle_array &particles )
+{
+    absorbed_particles_current_timestep_current_proc++;
+    absorbed_charge_current_timestep_current_proc += particles.charge;
+}
+
 bool Inner_region::check_if_node_inside( Node_reference &node,
 					 double dx, double dy, double dz )
 {
@@ -126,23 +129,22 @@ void Inner_region::select_near_boundary_nodes_not_at_domain_edge( Spatial_mesh &
     }    
 }
 
-void Inner_region::sync_absorbed_charge_and_particles_across_proc()
+void Inner_region::add_to_total_absorbed( int absorbed_particles, double absorbed_charge )
 {
-    int single = 1;
-
-    MPI_Allreduce( MPI_IN_PLACE, &absorbed_particles_current_timestep_current_proc, single,
-		   MPI_INT, MPI_SUM, MPI_COMM_WORLD );
-    MPI_Allreduce( MPI_IN_PLACE, &absorbed_charge_current_timestep_current_proc, single,
-		   MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD );
-    
-    total_absorbed_charge += absorbed_charge_current_timestep_current_proc;
-    total_absorbed_particles += absorbed_particles_current_timestep_current_proc;   
+    total_absorbed_charge += absorbed_charge;
+    total_absorbed_particles += absorbed_particles;
 
     absorbed_particles_current_timestep_current_proc = 0;
     absorbed_charge_current_timestep_current_proc = 0;
 }
 
 void Inner_region::write_to_file( hid_t regions_group_id )
+{
+    write_to_file( regions_group_id, total_absorbed_particles, total_absorbed_charge );
+}
+
+void Inner_region::write_to_file( hid_t regions_group_id,
+				  int absorbed_particles, double absorbed_charge )
 {
     hid_t current_region_group_id;
     herr_t status;
@@ -152,14 +154,34 @@ void Inner_region::write_to_file( hid_t regions_group_id )
 					 H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     hdf5_status_check( current_region_group_id );
 
-    write_hdf5_common_parameters( current_region_group_id );
+    write_hdf5_common_parameters( current_region_group_id,
+				  absorbed_particles, absorbed_charge );
     write_hdf5_region_specific_parameters( current_region_group_id );
 
     status = H5Gclose( current_region_group_id );
     hdf5_status_check( status );    
 }
 
-void Inner_region::write_hdf5_common_parameters( hid_t current_region_group_id )
+void Inner_region::read_from_file( hid_t regions_group_id )
+{
+    herr_t status;
+    std::string current_region_groupname = "./" + name;
+
+    status = H5LTget_attribute_int( regions_group_id,
+				    current_region_groupname.c_str(),
+				    "total_absorbed_particles",
+				    &total_absorbed_particles );
+    hdf5_status_check( status );
+    status = H5LTget_attribute_double( regions_group_id,
+				       current_region_groupname.c_str(),
+				       "total_absorbed_charge",
+				       &total_absorbed_charge );
+    hdf5_status_check( status );
+}
+
+void Inner_region::write_hdf5_common_parameters( hid_t current_region_group_id,
+						 int absorbed_particles,
+						 double absorbed_charge )
 {
     herr_t status;
     int single_element = 1;
@@ -178,13 +200,13 @@ void Inner_region::write_hdf5_common_parameters( hid_t current_region_group_id )
     status = H5LTset_attribute_int( current_region_group_id,
 				    current_region_groupname.c_str(),
 				    "total_absorbed_particles",
-				    &total_absorbed_particles, single_element );
+				    &absorbed_particles, single_element );
     hdf5_status_check( status );
 
     status = H5LTset_attribute_double( current_region_group_id,
 				       current_region_groupname.c_str(),
 				       "total_absorbed_charge",
-				       &total_absorbed_charge, single_element );
+				       &absorbed_charge, single_element );
     hdf5_status_check( status );
 }
 
@@ -198,6 +220,26 @@ void Inner_region::hdf5_status_check( herr_t status )
     }
 }
 
+// Bounding box of a cylinder: end discs extend from the axis
+// by radius * sin( angle between axis and coordinate axis ).
+void axial_bounding_box( Vec3d start, Vec3d end, double radius,
+			 Vec3d &lower, Vec3d &upper )
+{
+    Vec3d unit_axisvec = vec3d_normalized( vec3d_sub( end, start ) );
+    Vec3d extent = vec3d_init(
+	radius * sqrt( std::max( 0.0, 1.0 - pow( vec3d_x( unit_axisvec ), 2 ) ) ),
+	radius * sqrt( std::max( 0.0, 1.0 - pow( vec3d_y( unit_axisvec ), 2 ) ) ),
+	radius * sqrt( std::max( 0.0, 1.0 - pow( vec3d_z( unit_axisvec ), 2 ) ) ) );
+    lower = vec3d_sub( vec3d_init( std::min( vec3d_x( start ), vec3d_x( end ) ),
+				   std::min( vec3d_y( start ), vec3d_y( end ) ),
+				   std::min( vec3d_z( start ), vec3d_z( end ) ) ),
+		       extent );
+    upper = vec3d_add( vec3d_init( std::max( vec3d_x( start ), vec3d_x( end ) ),
+				   std::max( vec3d_y( start ), vec3d_y( end ) ),
+				   std::max( vec3d_z( start ), vec3d_z( end ) ) ),
+		       extent );
+}
+
 // Box
 
 Inner_region_box::Inner_region_box(
@@ -243,6 +285,19 @@ bool Inner_region_box::check_if_point_inside( double x, double y, double z )
     return in;
 }
 
+double Inner_region_box::signed_distance_estimate( double x, double y, double z )
+{
+    return std::max( { x - x_left, x_right - x,
+		       y - y_top, y_bottom - y,
+		       z - z_far, z_near - z } );
+}
+
+void Inner_region_box::bounding_box( Vec3d &lower, Vec3d &upper )
+{
+    lower = vec3d_init( x_right, y_bottom, z_near );
+    upper = vec3d_init( x_left, y_top, z_far );
+}
+
 
 void Inner_region_box::write_hdf5_region_specific_parameters(
     hid_t current_region_group_id )
@@ -327,6 +382,20 @@ bool Inner_region_sphere::check_if_point_inside( double x, double y, double z )
     return in;
 }
 
+double Inner_region_sphere::signed_distance_estimate( double x, double y, double z )
+{
+    double xdist = (x - origin_x);
+    double ydist = (y - origin_y);
+    double zdist = (z - origin_z);
+    return sqrt( xdist * xdist + ydist * ydist + zdist * zdist ) - radius;
+}
+
+void Inner_region_sphere::bounding_box( Vec3d &lower, Vec3d &upper )
+{
+    lower = vec3d_init( origin_x - radius, origin_y - radius, origin_z - radius );
+    upper = vec3d_init( origin_x + radius, origin_y + radius, origin_z + radius );
+}
+
 
 void Inner_region_sphere::write_hdf5_region_specific_parameters(
 	hid_t current_region_group_id )
@@ -414,6 +483,31 @@ bool Inner_region_cylinder::check_if_point_inside( double x, double y, double z
     return in;
 }
 
+double Inner_region_cylinder::signed_distance_estimate( double x, double y, double z )
+{
+    Vec3d pointvec = vec3d_init( (x - axis_start_x),
+				 (y - axis_start_y),
+				 (z - axis_start_z) );
+    Vec3d axisvec = vec3d_init( ( axis_end_x - axis_start_x ),
+				( axis_end_y - axis_start_y ),
+				( axis_end_z - axis_start_z ) );
+    Vec3d unit_axisvec = vec3d_normalized( axisvec );
+
+    double projection = vec3d_dot_product( pointvec, unit_axisvec );
+    Vec3d perp_to_axis = vec3d_sub( pointvec,
+				    vec3d_times_scalar( unit_axisvec, projection ) );
+    return std::max( { -projection,
+		       projection - vec3d_length( axisvec ),
+		       vec3d_length( perp_to_axis ) - radius } );
+}
+
+void Inner_region_cylinder::bounding_box( Vec3d &lower, Vec3d &upper )
+{
+    axial_bounding_box( vec3d_init( axis_start_x, axis_start_y, axis_start_z ),
+			vec3d_init( axis_end_x, axis_end_y, axis_end_z ),
+			radius, lower, upper );
+}
+
 
 void Inner_region_cylinder::write_hdf5_region_specific_parameters(
     hid_t current_region_group_id )
@@ -518,6 +612,32 @@ bool Inner_region_tube::check_if_point_inside( double x, double y, double z )
     return in;
 }
 
+double Inner_region_tube::signed_distance_estimate( double x, double y, double z )
+{
+    Vec3d pointvec = vec3d_init( (x - axis_start_x),
+				 (y - axis_start_y),
+				 (z - axis_start_z) );
+    Vec3d axisvec = vec3d_init( ( axis_end_x - axis_start_x ),
+				( axis_end_y - axis_start_y ),
+				( axis_end_z - axis_start_z ) );
+    Vec3d unit_axisvec = vec3d_normalized( axisvec );
+
+    double projection = vec3d_dot_product( pointvec, unit_axisvec );
+    Vec3d perp_to_axis = vec3d_sub( pointvec,
+				    vec3d_times_scalar( unit_axisvec, projection ) );
+    return std::max( { -projection,
+		       projection - vec3d_length( axisvec ),
+		       inner_radius - vec3d_length( perp_to_axis ),
+		       vec3d_length( perp_to_axis ) - outer_radius } );
+}
+
+void Inner_region_tube::bounding_box( Vec3d &lower, Vec3d &upper )
+{
+    axial_bounding_box( vec3d_init( axis_start_x, axis_start_y, axis_start_z ),
+			vec3d_init( axis_end_x, axis_end_y, axis_end_z ),
+			outer_radius, lower, upper );
+}
+
 
 void Inner_region_tube::write_hdf5_region_specific_parameters(
     hid_t current_region_group_id )
@@ -568,3 +688,74 @@ void Inner_region_tube::write_hdf5_region_specific_parameters(
 }
 
 
+
+
+void Inner_regions_manager::mark_cell_occupancy()
+{
+    if( regions.size() > (size_t)std::numeric_limits<short>::max() ){
+	std::cout << "Too many inner regions for cell occupancy map. Aborting."
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    cell_occupancy.assign( (size_t)x_n_cells * y_n_cells * z_n_cells,
+			   cell_outside_regions );
+    // A cell lies on one side of the region surface if estimate
+    // at its center exceeds half of its diagonal; small margin for round-off.
+    double half_diagonal = 0.5 * sqrt( x_cell_size * x_cell_size +
+				       y_cell_size * y_cell_size +
+				       z_cell_size * z_cell_size );
+    double margin = half_diagonal * ( 1.0 + 1e-6 );
+
+    // Regions are processed in the same order as in exact check,
+    // so the first region containing a particle absorbs it.
+    // Cells with center farther than 'margin' from region bounding box
+    // lie fully outside of it and are skipped.
+    for( size_t r = 0; r < regions.size(); r++ ){
+	Vec3d lower, upper;
+	regions[r].bounding_box( lower, upper );
+	int i_min = std::max( (int)floor( ( vec3d_x( lower ) - margin ) / x_cell_size - 0.5 ), 0 );
+	int j_min = std::max( (int)floor( ( vec3d_y( lower ) - margin ) / y_cell_size - 0.5 ), 0 );
+	int k_min = std::max( (int)floor( ( vec3d_z( lower ) - margin ) / z_cell_size - 0.5 ), 0 );
+	int i_max = std::min( (int)ceil( ( vec3d_x( upper ) + margin ) / x_cell_size - 0.5 ),
+			      x_n_cells - 1 );
+	int j_max = std::min( (int)ceil( ( vec3d_y( upper ) + margin ) / y_cell_size - 0.5 ),
+			      y_n_cells - 1 );
+	int k_max = std::min( (int)ceil( ( vec3d_z( upper ) + margin ) / z_cell_size - 0.5 ),
+			      z_n_cells - 1 );
+	for( int i = i_min; i <= i_max; i++ ){
+	    for( int j = j_min; j <= j_max; j++ ){
+		for( int k = k_min; k <= k_max; k++ ){
+		    short &occupancy = cell_occupancy[ ( i * y_n_cells + j ) * z_n_cells + k ];
+		    if( occupancy != cell_outside_regions )
+			continue;
+		    double distance = regions[r].signed_distance_estimate(
+			( i + 0.5 ) * x_cell_size,
+			( j + 0.5 ) * y_cell_size,
+			( k + 0.5 ) * z_cell_size );
+		    if( distance < -margin )
+			occupancy = r;
+		    else if( distance <= margin )
+			occupancy = cell_needs_exact_check;
+		}
+	    }
+	}
+    }
+    cell_occupancy_marked = true;
+}
+
+void Inner_regions_manager::sync_absorbed_charge_and_particles_across_proc()
+{
+    if( regions.empty() )
+	return;
+    // Particle counts are small enough to be summed exactly as doubles
+    std::vector<double> absorbed( 2 * regions.size() );
+    for( size_t r = 0; r < regions.size(); r++ ){
+	absorbed[ 2 * r ] = regions[r].absorbed_particles_current_timestep_current_proc;
+	absorbed[ 2 * r + 1 ] = regions[r].absorbed_charge_current_timestep_current_proc;
+    }
+    MPI_Allreduce( MPI_IN_PLACE, absorbed.data(), absorbed.size(),
+		   MPI_DOUBLE, MPI_SUM, PETSC_COMM_WORLD );
+    for( size_t r = 0; r < regions.size(); r++ ){
+	regions[r].add_to_total_absorbed( (int)absorbed[ 2 * r ], absorbed[ 2 * r + 1 ] );
+    }
+}
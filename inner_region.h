@@ -13,7 +13,7 @@
 #include "config.h"
 #include "spatial_mesh.h"
 #include "node_reference.h"
-#include "particle.h"
+#include "particle_array.h"
 #include "vec3d.h"
 
 class Inner_region{
@@ -43,10 +43,19 @@ public:
 	std::cout << "Inner region: name = " << name << std::endl;
 	std::cout << "potential = " << potential << std::endl;
     }
-    void sync_absorbed_charge_and_particles_across_proc();
+    // Absorbed particles and charge summed over processes
+    // are added to totals; current timestep counters are reset.
+    void add_to_total_absorbed( int absorbed_particles, double absorbed_charge );
     virtual bool check_if_point_inside( double x, double y, double z ) = 0;
-    bool check_if_particle_inside( Particle &p );
-    bool check_if_particle_inside_and_count_charge( Particle &p );
+    // Negative inside and positive outside of the region;
+    // changes not faster than distance to the point,
+    // so its absolute value never exceeds distance to region surface.
+    virtual double signed_distance_estimate( double x, double y, double z ) = 0;
+    // Axis-aligned box containing the region.
+    virtual void bounding_box( Vec3d &lower, Vec3d &upper ) = 0;
+    bool check_if_particle_inside( Particle_array &particles, size_t i );
+    bool check_if_particle_inside_and_count_charge( Particle_array &particles, size_t i );
+    void count_absorbed_particle( Particle_array &particles );
     bool check_if_node_inside( Node_reference &node, double dx, double dy, double dz );
     void print_inner_nodes() {
 	std::cout << "Inner nodes of '" << name << "' object." << std::endl;
@@ -60,13 +69,17 @@ public:
     };
     // Write to file
     void write_to_file( hid_t regions_group_id );
+    void write_to_file( hid_t regions_group_id,
+			int absorbed_particles, double absorbed_charge );
+    void read_from_file( hid_t regions_group_id );
     void hdf5_status_check( herr_t status );
 protected:
     void mark_inner_nodes( Spatial_mesh &spat_mesh );
     void select_inner_nodes_not_at_domain_edge( Spatial_mesh &spat_mesh );
     void mark_near_boundary_nodes( Spatial_mesh &spat_mesh );
     void select_near_boundary_nodes_not_at_domain_edge( Spatial_mesh &spat_mesh );
-    void write_hdf5_common_parameters( hid_t current_region_group_id );
+    void write_hdf5_common_parameters( hid_t current_region_group_id,
+				       int absorbed_particles, double absorbed_charge );
     virtual void write_hdf5_region_specific_parameters(
 	hid_t current_region_group_id ) = 0;
 private:
@@ -102,6 +115,10 @@ public:
 	std::cout << "z_far = " << z_far << std::endl;
     }
     virtual bool check_if_point_inside( double x, double y, double z );
+    // Exact inside the box; outside it is the largest distance
+    // along a single axis, a lower bound of the distance.
+    virtual double signed_distance_estimate( double x, double y, double z );
+    virtual void bounding_box( Vec3d &lower, Vec3d &upper );
 private:
     virtual void check_correctness_of_related_config_fields(
 	Config &conf,
@@ -134,6 +151,8 @@ public:
 	std::cout << "radius = " << radius << std::endl;
     }
     virtual bool check_if_point_inside( double x, double y, double z );
+    virtual double signed_distance_estimate( double x, double y, double z );
+    virtual void bounding_box( Vec3d &lower, Vec3d &upper );
 private:
     virtual void check_correctness_of_related_config_fields(
 	Config &conf,
@@ -172,6 +191,8 @@ public:
 	std::cout << "radius = " << radius << std::endl;
     }
     virtual bool check_if_point_inside( double x, double y, double z );
+    virtual double signed_distance_estimate( double x, double y, double z );
+    virtual void bounding_box( Vec3d &lower, Vec3d &upper );
 
 private:
     virtual void check_correctness_of_related_config_fields(
@@ -213,6 +234,8 @@ public:
 	std::cout << "outer_radius = " << outer_radius << std::endl;
     }
     virtual bool check_if_point_inside( double x, double y, double z );
+    virtual double signed_distance_estimate( double x, double y, double z );
+    virtual void bounding_box( Vec3d &lower, Vec3d &upper );
 private:
     virtual void check_correctness_of_related_config_fields(
 	Config &conf,
@@ -228,8 +251,25 @@ private:
 class Inner_regions_manager{
 public:
     boost::ptr_vector<Inner_region> regions;
+private:
+    // Each mesh cell is either outside of all regions, fully inside
+    // one of them (value is region index) or crossed by some region surface.
+    // Only particles in the last kind of cells need exact geometric test.
+    // Built on first use, since fields solver doesn't need it.
+    enum { cell_outside_regions = -1, cell_needs_exact_check = -2 };
+    std::vector<short> cell_occupancy;
+    bool cell_occupancy_marked;
+    int x_n_cells, y_n_cells, z_n_cells;
+    double x_cell_size, y_cell_size, z_cell_size;
 public:
-    Inner_regions_manager( Config &conf, Spatial_mesh &spat_mesh )
+    Inner_regions_manager( Config &conf, Spatial_mesh &spat_mesh ) :
+	cell_occupancy_marked( false ),
+	x_n_cells( spat_mesh.x_n_nodes - 1 ),
+	y_n_cells( spat_mesh.y_n_nodes - 1 ),
+	z_n_cells( spat_mesh.z_n_nodes - 1 ),
+	x_cell_size( spat_mesh.x_cell_size ),
+	y_cell_size( spat_mesh.y_cell_size ),
+	z_cell_size( spat_mesh.z_cell_size )
     {
 	for( auto &inner_region_conf : conf.inner_regions_config_part ){
 	    if( Inner_region_box_config_part *box_conf =
@@ -263,29 +303,47 @@ public:
 
     virtual ~Inner_regions_manager() {};    
 
-    bool check_if_particle_inside( Particle &p )
+    bool check_if_particle_inside( Particle_array &particles, size_t i )
     {
 	for( auto &region : regions ){
-	    if( region.check_if_particle_inside( p ) )
+	    if( region.check_if_particle_inside( particles, i ) )
 		return true;
 	}
 	return false;
     }
 
-    bool check_if_particle_inside_and_count_charge( Particle &p )
+    bool check_if_particle_inside_and_count_charge( Particle_array &particles, size_t i )
     {
+	if( !cell_occupancy_marked )
+	    mark_cell_occupancy();
+	short occupancy = cell_occupancy[ cell_containing_particle( particles, i ) ];
+	if( occupancy == cell_outside_regions )
+	    return false;
+	if( occupancy != cell_needs_exact_check ){
+	    regions[ occupancy ].count_absorbed_particle( particles );
+	    return true;
+	}
 	for( auto &region : regions ){
-	    if( region.check_if_particle_inside_and_count_charge( p ) )
+	    if( region.check_if_particle_inside_and_count_charge( particles, i ) )
 		return true;
 	}
 	return false;
     }
 
-    void sync_absorbed_charge_and_particles_across_proc()
+    void mark_cell_occupancy();
+    int cell_containing_particle( Particle_array &particles, size_t i )
     {
-	for( auto &region : regions )
-	    region.sync_absorbed_charge_and_particles_across_proc();
+	int ci = std::min( std::max( (int)floor( particles.x[i] / x_cell_size ), 0 ),
+			   x_n_cells - 1 );
+	int cj = std::min( std::max( (int)floor( particles.y[i] / y_cell_size ), 0 ),
+			   y_n_cells - 1 );
+	int ck = std::min( std::max( (int)floor( particles.z[i] / z_cell_size ), 0 ),
+			   z_n_cells - 1 );
+	return ( ci * y_n_cells + cj ) * z_n_cells + ck;
     }
+
+    // Counters of all regions are summed over processes in a single call.
+    void sync_absorbed_charge_and_particles_across_proc();
     
     void print( )
     {
@@ -304,11 +362,23 @@ public:
     }
 
     void write_to_file( hid_t hdf5_file_id )
+    {
+	std::vector<int> absorbed_particles;
+	std::vector<double> absorbed_charge;
+	for( auto &reg : regions ){
+	    absorbed_particles.push_back( reg.total_absorbed_particles );
+	    absorbed_charge.push_back( reg.total_absorbed_charge );
+	}
+	write_to_file( hdf5_file_id, absorbed_particles, absorbed_charge );
+    };
+    void write_to_file( hid_t hdf5_file_id,
+			std::vector<int> &absorbed_particles,
+			std::vector<double> &absorbed_charge )
     {
 	hid_t group_id;
 	herr_t status;
 	int single_element = 1;
-	std::string hdf5_groupname = "/Inner_regions";
+	std::string hdf5_groupname = "./Inner_regions";
 	int n_of_regions = regions.size();
 	group_id = H5Gcreate2(
 	    hdf5_file_id, hdf5_groupname.c_str(),
@@ -320,12 +390,27 @@ public:
 	    "number_of_regions", &n_of_regions, single_element );
 	hdf5_status_check( status );
 	
-	for( auto &reg : regions )
-	    reg.write_to_file( group_id );
+	for( size_t i = 0; i < regions.size(); i++ )
+	    regions[i].write_to_file( group_id,
+				      absorbed_particles[i], absorbed_charge[i] );
 
 	status = H5Gclose(group_id);
 	hdf5_status_check( status );
     }; 
+    void read_from_file( hid_t hdf5_file_id )
+    {
+	hid_t group_id;
+	herr_t status;
+	std::string hdf5_groupname = "/Inner_regions";
+	group_id = H5Gopen2( hdf5_file_id, hdf5_groupname.c_str(), H5P_DEFAULT );
+	hdf5_status_check( group_id );
+
+	for( auto &reg : regions )
+	    reg.read_from_file( group_id );
+
+	status = H5Gclose(group_id);
+	hdf5_status_check( status );
+    };
 
     void hdf5_status_check( herr_t status )
     {
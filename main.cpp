@@ -1,45 +1,124 @@
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include "config.h"
 #include "domain.h"
+#include "potential_sweep.h"
+#include "ensemble_batch.h"
 #include "parse_cmd_line.h"
 
-void pic_simulation( Config &conf );
+void split_processes_into_groups( int &n_of_groups, int n_of_configs,
+				  int &group_num, MPI_Comm *group_comm );
+void pic_simulation( Config &conf, const std::string &checkpoint_file );
+void potential_sweep( Config &conf, const std::string &sweep_file,
+		      int group_num, int n_of_groups );
+void ensemble_batch( const std::vector<std::string> &config_files,
+		     int group_num, int n_of_groups );
 
 int main( int argc, char *argv[] )
 {
-    std::string config_file;
+    std::vector<std::string> config_files;
+    std::string checkpoint_file;
+    std::string sweep_file;
+    int n_of_groups;
+    int group_num;
+    MPI_Comm group_comm;
 
     // prepare everything
     PetscErrorCode ierr;
     PetscMPIInt mpi_comm_size;
     int mpi_process_rank;
+    // Asynchronous output writes files from a separate thread
+    int mpi_thread_support;
+    MPI_Init_thread( &argc, &argv, MPI_THREAD_MULTIPLE, &mpi_thread_support );
+
+    //// Parse command line
+    parse_cmd_line( argc, argv, config_files, checkpoint_file, sweep_file, n_of_groups );
+    // PETSC_COMM_WORLD has to be set before PetscInitialize;
+    // everything else uses it instead of MPI_COMM_WORLD.
+    split_processes_into_groups( n_of_groups, config_files.size(), group_num, &group_comm );
+    PETSC_COMM_WORLD = group_comm;
     PetscInitialize( &argc, &argv, (char*)0, NULL );
     ierr = MPI_Comm_size( PETSC_COMM_WORLD, &mpi_comm_size); CHKERRXX(ierr);
     MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
 
-    //// Parse command line
-    parse_cmd_line( argc, argv, config_file );
-    //// Read config
-    Config conf( config_file );
-    if ( mpi_process_rank == 0 )
-    	conf.print();
     // run simulation
-    pic_simulation( conf );
+    if ( config_files.size() > 1 ) {
+	ensemble_batch( config_files, group_num, n_of_groups );
+    } else {
+	//// Read config
+	Config conf( config_files.front() );
+	if ( mpi_process_rank == 0 )
+	    conf.print();
+	if ( sweep_file.empty() )
+	    pic_simulation( conf, checkpoint_file );
+	else
+	    potential_sweep( conf, sweep_file, group_num, n_of_groups );
+    }
 
     // finalize_whatever_left
     ierr = PetscFinalize(); CHKERRXX(ierr);
+    MPI_Comm_free( &group_comm );
+    MPI_Finalize();
     return 0;
 }
 
-void pic_simulation( Config &conf )
+void split_processes_into_groups( int &n_of_groups, int n_of_configs,
+				  int &group_num, MPI_Comm *group_comm )
+{
+    int world_size, world_rank;
+    MPI_Comm_size( MPI_COMM_WORLD, &world_size );
+    MPI_Comm_rank( MPI_COMM_WORLD, &world_rank );
+
+    if ( n_of_groups == 0 )
+	n_of_groups = std::min( n_of_configs, world_size );
+    if ( n_of_groups > world_size ) {
+	if ( world_rank == 0 )
+	    std::cout << "Error: more groups than processes requested." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    if ( n_of_groups > n_of_configs && n_of_configs > 1 ) {
+	if ( world_rank == 0 )
+	    std::cout << "Error: more groups than config files requested." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    // Contiguous blocks of ranks
+    group_num = (long long)world_rank * n_of_groups / world_size;
+    MPI_Comm_split( MPI_COMM_WORLD, group_num, world_rank, group_comm );
+}
+
+void pic_simulation( Config &conf, const std::string &checkpoint_file )
 {
     Domain dom( conf );
 
-    // fields in domain without any particles
-    dom.eval_and_write_fields_without_particles( conf );
+    if ( checkpoint_file.empty() ){
+	// fields in domain without any particles
+	dom.eval_and_write_fields_without_particles( conf );
+    } else {
+	dom.restart_from_checkpoint( checkpoint_file );
+    }
     // run simulation
     dom.run_pic( conf );
 
     return;
 }
+
+void potential_sweep( Config &conf, const std::string &sweep_file,
+		      int group_num, int n_of_groups )
+{
+    Potential_sweep sweep( conf, sweep_file, group_num, n_of_groups );
+    sweep.run( conf );
+
+    return;
+}
+
+void ensemble_batch( const std::vector<std::string> &config_files,
+		     int group_num, int n_of_groups )
+{
+    Ensemble_batch batch( config_files, group_num, n_of_groups );
+    batch.run();
+
+    return;
+}
@@ -0,0 +1,456 @@
+#include "multigrid_poisson_solver.h"
+
+Multigrid_poisson_solver::Multigrid_poisson_solver(
+    Spatial_mesh &spat_mesh, Inner_regions_manager &inner_regions )
+{
+    rtol = 1.e-10;
+    max_v_cycles = 50;
+    n_presmoothing_sweeps = 2;
+    n_postsmoothing_sweeps = 2;
+    n_of_v_cycles_done = 0;
+    relative_residual = 0.0;
+
+    init_finest_level( spat_mesh );
+    add_coarse_levels();
+    mark_dirichlet_nodes_at_finest_level( inner_regions );
+    mark_dirichlet_nodes_at_coarse_levels();
+}
+
+void Multigrid_poisson_solver::init_finest_level( Spatial_mesh &spat_mesh )
+{
+    Grid_level finest;
+    finest.nx = spat_mesh.x_n_nodes;
+    finest.ny = spat_mesh.y_n_nodes;
+    finest.nz = spat_mesh.z_n_nodes;
+    finest.dx = spat_mesh.x_cell_size;
+    finest.dy = spat_mesh.y_cell_size;
+    finest.dz = spat_mesh.z_cell_size;
+    finest.rhs.resize( finest.num_elements() );
+    finest.residual.resize( finest.num_elements() );
+    finest.dirichlet_node.resize( finest.num_elements() );
+    levels.push_back( finest );
+    // Potential at the finest level is not copied
+    levels[0].phi = spat_mesh.potential.data();
+}
+
+int Multigrid_poisson_solver::n_of_nodes_after_coarsening( int n_nodes )
+{
+    int n_cells = n_nodes - 1;
+    if( n_cells < 4 )
+	return n_nodes;
+    return ( n_cells + 1 ) / 2 + 1;
+}
+
+void Multigrid_poisson_solver::init_axis_transfer( Axis_transfer &t,
+						   int n_fine, int n_coarse )
+{
+    // Fine node 'i' is at coarse coordinate i * cf / ff;
+    // integer arithmetic keeps nested nodes exact.
+    long long ff = n_fine - 1;
+    long long cf = n_coarse - 1;
+    t.left_node.resize( n_fine );
+    t.left_weight.resize( n_fine );
+    for( int i = 0; i < n_fine; i++ ){
+	long long left = std::min( i * cf / ff, cf - 1 );
+	t.left_node[i] = left;
+	t.left_weight[i] = 1.0 - (double)( i * cf - left * ff ) / ff;
+    }
+    // Restriction is the transposed interpolation scaled by
+    // ratio of cell sizes, so that constant residual stays the same.
+    t.first_fine_node.resize( n_coarse );
+    t.restriction_weights.assign( n_coarse, std::vector<double>() );
+    t.nearest_fine_node.resize( n_coarse );
+    for( int I = 0; I < n_coarse; I++ ){
+	// Only fine nodes with nonzero weights, closer than
+	// a coarse cell to the coarse node, are kept.
+	int first = std::max( ( I - 1 ) * ff / cf + 1, 0LL );
+	int last = std::min( ( ( I + 1 ) * ff - 1 ) / cf, ff );
+	t.first_fine_node[I] = first;
+	for( int i = first; i <= last; i++ ){
+	    double weight = 1.0 - (double)std::abs( i * cf - I * ff ) / ff;
+	    t.restriction_weights[I].push_back( weight * cf / ff );
+	}
+	t.nearest_fine_node[I] = ( 2 * I * ff + cf ) / ( 2 * cf );
+    }
+}
+
+void Multigrid_poisson_solver::add_coarse_levels()
+{
+    while( true ){
+	Grid_level &fine = levels.back();
+	Grid_level coarse;
+	coarse.nx = n_of_nodes_after_coarsening( fine.nx );
+	coarse.ny = n_of_nodes_after_coarsening( fine.ny );
+	coarse.nz = n_of_nodes_after_coarsening( fine.nz );
+	if( coarse.nx == fine.nx && coarse.ny == fine.ny && coarse.nz == fine.nz )
+	    break;
+	coarse.dx = fine.dx * ( fine.nx - 1 ) / ( coarse.nx - 1 );
+	coarse.dy = fine.dy * ( fine.ny - 1 ) / ( coarse.ny - 1 );
+	coarse.dz = fine.dz * ( fine.nz - 1 ) / ( coarse.nz - 1 );
+	init_axis_transfer( coarse.tx, fine.nx, coarse.nx );
+	init_axis_transfer( coarse.ty, fine.ny, coarse.ny );
+	init_axis_transfer( coarse.tz, fine.nz, coarse.nz );
+	coarse.phi_storage.resize( coarse.num_elements() );
+	coarse.rhs.resize( coarse.num_elements() );
+	coarse.residual.resize( coarse.num_elements() );
+	coarse.dirichlet_node.resize( coarse.num_elements() );
+	levels.push_back( coarse );
+    }
+    for( size_t l = 1; l < levels.size(); l++ )
+	levels[l].phi = levels[l].phi_storage.data();
+}
+
+void Multigrid_poisson_solver::mark_dirichlet_nodes_at_finest_level(
+    Inner_regions_manager &inner_regions )
+{
+    Grid_level &lvl = levels[0];
+    for( int i = 0; i < lvl.nx; i++ )
+	for( int j = 0; j < lvl.ny; j++ )
+	    for( int k = 0; k < lvl.nz; k++ )
+		lvl.dirichlet_node[ lvl.idx( i, j, k ) ] =
+		    ( i == 0 || i == lvl.nx - 1 ||
+		      j == 0 || j == lvl.ny - 1 ||
+		      k == 0 || k == lvl.nz - 1 );
+
+    for( auto &reg : inner_regions.regions )
+	for( auto &node : reg.inner_nodes )
+	    lvl.dirichlet_node[ lvl.idx( node.x, node.y, node.z ) ] = true;
+}
+
+void Multigrid_poisson_solver::mark_dirichlet_nodes_at_coarse_levels()
+{
+    // Coarse node is a Dirichlet one if the closest node
+    // of the finer level is; domain boundaries coincide.
+    for( size_t l = 1; l < levels.size(); l++ ){
+	Grid_level &fine = levels[l-1];
+	Grid_level &coarse = levels[l];
+	for( int i = 0; i < coarse.nx; i++ )
+	    for( int j = 0; j < coarse.ny; j++ )
+		for( int k = 0; k < coarse.nz; k++ ){
+		    int fi = coarse.tx.nearest_fine_node[i];
+		    int fj = coarse.ty.nearest_fine_node[j];
+		    int fk = coarse.tz.nearest_fine_node[k];
+		    coarse.dirichlet_node[ coarse.idx( i, j, k ) ] =
+			fine.dirichlet_node[ fine.idx( fi, fj, fk ) ];
+		}
+    }
+}
+
+
+void Multigrid_poisson_solver::solve( Spatial_mesh &spat_mesh,
+				      Inner_regions_manager &inner_regions )
+{
+    Grid_level &finest = levels[0];
+    // Solver may be passed on to another mesh of the same size
+    finest.phi = spat_mesh.potential.data();
+
+    set_potential_at_inner_regions( spat_mesh, inner_regions );
+    eval_rhs_at_finest_level( spat_mesh );
+
+    // Potential from the previous time step is used as initial guess.
+    double rhs_norm = norm_of_rhs_with_dirichlet_contributions( finest );
+    if( rhs_norm == 0.0 )
+	rhs_norm = 1.0;
+    eval_residual( finest );
+    relative_residual = norm( finest.residual, finest ) / rhs_norm;
+    n_of_v_cycles_done = 0;
+    while( relative_residual > rtol && n_of_v_cycles_done < max_v_cycles ){
+	v_cycle( 0 );
+	n_of_v_cycles_done++;
+	eval_residual( finest );
+	relative_residual = norm( finest.residual, finest ) / rhs_norm;
+    }
+
+    if( relative_residual > rtol ){
+	int mpi_process_rank;
+	MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+	if( mpi_process_rank == 0 ){
+	    std::cout << "Warning: multigrid solver has not converged after "
+		      << n_of_v_cycles_done << " V-cycles; "
+		      << "relative residual = " << relative_residual << std::endl;
+	}
+    }
+}
+
+void Multigrid_poisson_solver::set_potential_at_inner_regions(
+    Spatial_mesh &spat_mesh, Inner_regions_manager &inner_regions )
+{
+    for( auto &reg : inner_regions.regions )
+	for( auto &node : reg.inner_nodes_not_at_domain_edge )
+	    spat_mesh.potential[node.x][node.y][node.z] = reg.potential;
+}
+
+void Multigrid_poisson_solver::eval_rhs_at_finest_level( Spatial_mesh &spat_mesh )
+{
+    Grid_level &lvl = levels[0];
+    const double *rho = spat_mesh.charge_density.data();
+    for( size_t n = 0; n < lvl.num_elements(); n++ )
+	lvl.rhs[n] = -4.0 * M_PI * rho[n];
+}
+
+double Multigrid_poisson_solver::norm_of_rhs_with_dirichlet_contributions(
+    Grid_level &lvl )
+{
+    // Norm of the right hand side of the system for free nodes only:
+    // terms with known potential of Dirichlet neighbours
+    // are moved to the right hand side.
+    double cx = 1.0 / ( lvl.dx * lvl.dx );
+    double cy = 1.0 / ( lvl.dy * lvl.dy );
+    double cz = 1.0 / ( lvl.dz * lvl.dz );
+    double sum = 0.0;
+    size_t si = (size_t)lvl.ny * lvl.nz;
+    size_t sj = lvl.nz;
+
+    #pragma omp parallel for reduction( +:sum ) schedule( static )
+    for( int i = 1; i < lvl.nx - 1; i++ ){
+	for( int j = 1; j < lvl.ny - 1; j++ ){
+	    for( int k = 1; k < lvl.nz - 1; k++ ){
+		size_t n = lvl.idx( i, j, k );
+		if( lvl.dirichlet_node[n] )
+		    continue;
+		double b = lvl.rhs[n];
+		if( lvl.dirichlet_node[n - si] ) b -= cx * lvl.phi[n - si];
+		if( lvl.dirichlet_node[n + si] ) b -= cx * lvl.phi[n + si];
+		if( lvl.dirichlet_node[n - sj] ) b -= cy * lvl.phi[n - sj];
+		if( lvl.dirichlet_node[n + sj] ) b -= cy * lvl.phi[n + sj];
+		if( lvl.dirichlet_node[n - 1] ) b -= cz * lvl.phi[n - 1];
+		if( lvl.dirichlet_node[n + 1] ) b -= cz * lvl.phi[n + 1];
+		sum += b * b;
+	    }
+	}
+    }
+    return sqrt( sum );
+}
+
+void Multigrid_poisson_solver::v_cycle( int level_num )
+{
+    Grid_level &lvl = levels[ level_num ];
+    if( level_num == (int)levels.size() - 1 ){
+	solve_at_coarsest_level( lvl );
+	return;
+    }
+    Grid_level &coarse = levels[ level_num + 1 ];
+
+    smooth( lvl, n_presmoothing_sweeps );
+    eval_residual( lvl );
+    restrict_residual( lvl, coarse );
+    v_cycle( level_num + 1 );
+    prolongate_and_add_correction( coarse, lvl );
+    smooth( lvl, n_postsmoothing_sweeps );
+}
+
+void Multigrid_poisson_solver::smooth( Grid_level &lvl, int n_sweeps )
+{
+    // Red-black Gauss-Seidel; nodes of the same color
+    // do not depend on each other and are updated in parallel.
+    double cx = 1.0 / ( lvl.dx * lvl.dx );
+    double cy = 1.0 / ( lvl.dy * lvl.dy );
+    double cz = 1.0 / ( lvl.dz * lvl.dz );
+    double diag = 2.0 * ( cx + cy + cz );
+    size_t si = (size_t)lvl.ny * lvl.nz;
+    size_t sj = lvl.nz;
+    double *phi = lvl.phi;
+
+    for( int sweep = 0; sweep < n_sweeps; sweep++ ){
+	for( int color = 0; color < 2; color++ ){
+	    #pragma omp parallel for schedule( static )
+	    for( int i = 1; i < lvl.nx - 1; i++ ){
+		for( int j = 1; j < lvl.ny - 1; j++ ){
+		    int k_first = 1 + ( i + j + 1 + color ) % 2;
+		    for( int k = k_first; k < lvl.nz - 1; k += 2 ){
+			size_t n = lvl.idx( i, j, k );
+			if( lvl.dirichlet_node[n] )
+			    continue;
+			phi[n] = ( cx * ( phi[n - si] + phi[n + si] ) +
+				   cy * ( phi[n - sj] + phi[n + sj] ) +
+				   cz * ( phi[n - 1] + phi[n + 1] ) -
+				   lvl.rhs[n] ) / diag;
+		    }
+		}
+	    }
+	}
+    }
+}
+
+void Multigrid_poisson_solver::eval_residual( Grid_level &lvl )
+{
+    double cx = 1.0 / ( lvl.dx * lvl.dx );
+    double cy = 1.0 / ( lvl.dy * lvl.dy );
+    double cz = 1.0 / ( lvl.dz * lvl.dz );
+    size_t si = (size_t)lvl.ny * lvl.nz;
+    size_t sj = lvl.nz;
+    const double *phi = lvl.phi;
+
+    std::fill( lvl.residual.begin(), lvl.residual.end(), 0.0 );
+    #pragma omp parallel for schedule( static )
+    for( int i = 1; i < lvl.nx - 1; i++ ){
+	for( int j = 1; j < lvl.ny - 1; j++ ){
+	    for( int k = 1; k < lvl.nz - 1; k++ ){
+		size_t n = lvl.idx( i, j, k );
+		if( lvl.dirichlet_node[n] )
+		    continue;
+		double laplacian =
+		    cx * ( phi[n - si] - 2.0 * phi[n] + phi[n + si] ) +
+		    cy * ( phi[n - sj] - 2.0 * phi[n] + phi[n + sj] ) +
+		    cz * ( phi[n - 1] - 2.0 * phi[n] + phi[n + 1] );
+		lvl.residual[n] = lvl.rhs[n] - laplacian;
+	    }
+	}
+    }
+}
+
+double Multigrid_poisson_solver::norm( const std::vector<double> &values, Grid_level &lvl )
+{
+    double sum = 0.0;
+    #pragma omp parallel for reduction( +:sum ) schedule( static )
+    for( size_t n = 0; n < lvl.num_elements(); n++ )
+	sum += values[n] * values[n];
+    return sqrt( sum );
+}
+
+void Multigrid_poisson_solver::restrict_residual( Grid_level &fine, Grid_level &coarse )
+{
+    // Transposed interpolation along each axis; identity
+    // along axes which are not coarsened.
+    std::fill( coarse.phi_storage.begin(), coarse.phi_storage.end(), 0.0 );
+    std::fill( coarse.rhs.begin(), coarse.rhs.end(), 0.0 );
+    #pragma omp parallel for schedule( static )
+    for( int i = 1; i < coarse.nx - 1; i++ ){
+	const std::vector<double> &wx = coarse.tx.restriction_weights[i];
+	int fi = coarse.tx.first_fine_node[i];
+	for( int j = 1; j < coarse.ny - 1; j++ ){
+	    const std::vector<double> &wy = coarse.ty.restriction_weights[j];
+	    int fj = coarse.ty.first_fine_node[j];
+	    for( int k = 1; k < coarse.nz - 1; k++ ){
+		size_t n = coarse.idx( i, j, k );
+		if( coarse.dirichlet_node[n] )
+		    continue;
+		const std::vector<double> &wz = coarse.tz.restriction_weights[k];
+		int fk = coarse.tz.first_fine_node[k];
+		double sum = 0.0;
+		for( size_t a = 0; a < wx.size(); a++ ){
+		    for( size_t b = 0; b < wy.size(); b++ ){
+			for( size_t c = 0; c < wz.size(); c++ ){
+			    sum += wx[a] * wy[b] * wz[c] *
+				fine.residual[ fine.idx( fi + a, fj + b, fk + c ) ];
+			}
+		    }
+		}
+		coarse.rhs[n] = sum;
+	    }
+	}
+    }
+}
+
+void Multigrid_poisson_solver::prolongate_and_add_correction( Grid_level &coarse,
+							      Grid_level &fine )
+{
+    // Trilinear interpolation of coarse level correction.
+    #pragma omp parallel for schedule( static )
+    for( int i = 1; i < fine.nx - 1; i++ ){
+	int ci = coarse.tx.left_node[i];
+	double wi[2] = { coarse.tx.left_weight[i], 1.0 - coarse.tx.left_weight[i] };
+	for( int j = 1; j < fine.ny - 1; j++ ){
+	    int cj = coarse.ty.left_node[j];
+	    double wj[2] = { coarse.ty.left_weight[j], 1.0 - coarse.ty.left_weight[j] };
+	    for( int k = 1; k < fine.nz - 1; k++ ){
+		size_t n = fine.idx( i, j, k );
+		if( fine.dirichlet_node[n] )
+		    continue;
+		int ck = coarse.tz.left_node[k];
+		double wk[2] = { coarse.tz.left_weight[k], 1.0 - coarse.tz.left_weight[k] };
+		double correction = 0.0;
+		for( int a = 0; a < 2; a++ ){
+		    if( wi[a] == 0.0 )
+			continue;
+		    for( int b = 0; b < 2; b++ ){
+			if( wj[b] == 0.0 )
+			    continue;
+			for( int c = 0; c < 2; c++ ){
+			    if( wk[c] == 0.0 )
+				continue;
+			    correction += wi[a] * wj[b] * wk[c] *
+				coarse.phi[ coarse.idx( ci + a, cj + b, ck + c ) ];
+			}
+		    }
+		}
+		fine.phi[n] += correction;
+	    }
+	}
+    }
+}
+
+void Multigrid_poisson_solver::solve_at_coarsest_level( Grid_level &lvl )
+{
+    // Conjugate gradients for correction 'x': -A x = -residual,
+    // x = 0 at Dirichlet nodes.
+    double coarse_rtol = 1.e-8;
+    size_t n_el = lvl.num_elements();
+    std::vector<double> &r = lvl.residual;
+    cg_x.assign( n_el, 0.0 );
+    cg_p.resize( n_el );
+    cg_q.resize( n_el );
+
+    eval_residual( lvl );
+    for( size_t n = 0; n < n_el; n++ ){
+	r[n] = -r[n];
+	cg_p[n] = r[n];
+    }
+    double rr = dot_product( r, r );
+    double rr_stop = coarse_rtol * coarse_rtol * rr;
+    int max_iterations = n_el;
+    for( int it = 0; it < max_iterations && rr > rr_stop; it++ ){
+	apply_minus_laplacian( lvl, cg_p, cg_q );
+	double alpha = rr / dot_product( cg_p, cg_q );
+	for( size_t n = 0; n < n_el; n++ ){
+	    cg_x[n] += alpha * cg_p[n];
+	    r[n] -= alpha * cg_q[n];
+	}
+	double rr_new = dot_product( r, r );
+	double beta = rr_new / rr;
+	rr = rr_new;
+	for( size_t n = 0; n < n_el; n++ )
+	    cg_p[n] = r[n] + beta * cg_p[n];
+    }
+
+    for( size_t n = 0; n < n_el; n++ )
+	lvl.phi[n] += cg_x[n];
+}
+
+void Multigrid_poisson_solver::apply_minus_laplacian( Grid_level &lvl,
+						      const std::vector<double> &x,
+						      std::vector<double> &y )
+{
+    double cx = 1.0 / ( lvl.dx * lvl.dx );
+    double cy = 1.0 / ( lvl.dy * lvl.dy );
+    double cz = 1.0 / ( lvl.dz * lvl.dz );
+    double diag = 2.0 * ( cx + cy + cz );
+    size_t si = (size_t)lvl.ny * lvl.nz;
+    size_t sj = lvl.nz;
+
+    std::fill( y.begin(), y.end(), 0.0 );
+    #pragma omp parallel for schedule( static )
+    for( int i = 1; i < lvl.nx - 1; i++ ){
+	for( int j = 1; j < lvl.ny - 1; j++ ){
+	    for( int k = 1; k < lvl.nz - 1; k++ ){
+		size_t n = lvl.idx( i, j, k );
+		if( lvl.dirichlet_node[n] )
+		    continue;
+		y[n] = diag * x[n]
+		    - cx * ( x[n - si] + x[n + si] )
+		    - cy * ( x[n - sj] + x[n + sj] )
+		    - cz * ( x[n - 1] + x[n + 1] );
+	    }
+	}
+    }
+}
+
+double Multigrid_poisson_solver::dot_product( const std::vector<double> &a,
+					      const std::vector<double> &b )
+{
+    double sum = 0.0;
+    #pragma omp parallel for reduction( +:sum ) schedule( static )
+    for( size_t n = 0; n < a.size(); n++ )
+	sum += a[n] * b[n];
+    return sum;
+}
@@ -0,0 +1,102 @@
+#ifndef _MULTIGRID_POISSON_SOLVER_H_
+#define _MULTIGRID_POISSON_SOLVER_H_
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <mpi.h>
+#include "spatial_mesh.h"
+#include "inner_region.h"
+#include "node_reference.h"
+
+// Matrix-free geometric multigrid solver for
+// d2phi/dx2 + d2phi/dy2 + d2phi/dz2 = -4 * pi * rho
+// on the nodes of Spatial_mesh.
+// Nodes on the domain boundary and nodes inside inner regions
+// are Dirichlet ones; their potential is not changed by the solver.
+// The finest level works directly on spat_mesh.potential.
+// Coarse levels are obtained by halving number of cells along each axis
+// with at least 4 cells, rounding up; for odd numbers of cells
+// coarse nodes don't coincide with fine ones. Corrections are
+// interpolated linearly along each axis and residual is restricted
+// by the transposed interpolation, which is full weighting
+// for even numbers of cells. V-cycles with red-black Gauss-Seidel
+// smoothing are repeated until relative residual drops below 'rtol'.
+// Coarsest level has at most 4 nodes along each axis
+// and is solved by conjugate gradients.
+// Mesh is replicated on all processes, so each process solves
+// the whole problem; loops are parallelized with OpenMP.
+class Multigrid_poisson_solver {
+  public:
+    double rtol;
+    int max_v_cycles;
+    int n_of_v_cycles_done;
+    double relative_residual;
+  public:
+    Multigrid_poisson_solver( Spatial_mesh &spat_mesh,
+			      Inner_regions_manager &inner_regions );
+    void solve( Spatial_mesh &spat_mesh,
+		Inner_regions_manager &inner_regions );
+    virtual ~Multigrid_poisson_solver() {};
+  private:
+    // Transfer between nodes of the finer level and of this one
+    // along a single axis; both span the same interval.
+    struct Axis_transfer {
+	// Fine node 'i' is interpolated from coarse nodes
+	// left_node[i] and left_node[i] + 1 with weights
+	// left_weight[i] and 1 - left_weight[i].
+	std::vector<int> left_node;
+	std::vector<double> left_weight;
+	// Coarse node 'I' gathers fine nodes starting from
+	// first_fine_node[I] with restriction_weights[I].
+	std::vector<int> first_fine_node;
+	std::vector< std::vector<double> > restriction_weights;
+	// Fine node closest to coarse node 'I'
+	std::vector<int> nearest_fine_node;
+    };
+    struct Grid_level {
+	int nx, ny, nz;
+	double dx, dy, dz;
+	// Transfer from the finer level; unused at the finest one
+	Axis_transfer tx, ty, tz;
+	double *phi;
+	std::vector<double> phi_storage;
+	std::vector<double> rhs;
+	std::vector<double> residual;
+	std::vector<char> dirichlet_node;
+	size_t idx( int i, int j, int k ) const {
+	    return ( (size_t)i * ny + j ) * nz + k;
+	};
+	size_t num_elements() const { return (size_t)nx * ny * nz; };
+    };
+    std::vector<Grid_level> levels;
+    int n_presmoothing_sweeps, n_postsmoothing_sweeps;
+    // Coarsest level solver
+    std::vector<double> cg_x, cg_p, cg_q;
+    // Setup
+    void init_finest_level( Spatial_mesh &spat_mesh );
+    int n_of_nodes_after_coarsening( int n_nodes );
+    void init_axis_transfer( Axis_transfer &t, int n_fine, int n_coarse );
+    void add_coarse_levels();
+    void mark_dirichlet_nodes_at_finest_level( Inner_regions_manager &inner_regions );
+    void mark_dirichlet_nodes_at_coarse_levels();
+    // Solve
+    void set_potential_at_inner_regions( Spatial_mesh &spat_mesh,
+					 Inner_regions_manager &inner_regions );
+    void eval_rhs_at_finest_level( Spatial_mesh &spat_mesh );
+    double norm_of_rhs_with_dirichlet_contributions( Grid_level &lvl );
+    void v_cycle( int level_num );
+    void smooth( Grid_level &lvl, int n_sweeps );
+    void eval_residual( Grid_level &lvl );
+    double norm( const std::vector<double> &values, Grid_level &lvl );
+    void restrict_residual( Grid_level &fine, Grid_level &coarse );
+    void prolongate_and_add_correction( Grid_level &coarse, Grid_level &fine );
+    void solve_at_coarsest_level( Grid_level &lvl );
+    void apply_minus_laplacian( Grid_level &lvl, const std::vector<double> &x,
+				std::vector<double> &y );
+    double dot_product( const std::vector<double> &a, const std::vector<double> &b );
+};
+
+#endif /* _MULTIGRID_POISSON_SOLVER_H_ */
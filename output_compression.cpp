@@ -0,0 +1,89 @@
+#include "output_compression.h"
+
+Output_compression::Output_compression( Config &conf ) :
+    enabled( conf.output_compression_config_part.output_compression != "none" ),
+    compression( conf.output_compression_config_part.output_compression ),
+    deflate_level( conf.output_compression_config_part.deflate_level ),
+    scale_offset_decimal_digits(
+	conf.output_compression_config_part.scale_offset_decimal_digits )
+{
+    check_correctness_of_related_config_fields( conf );
+    if( enabled )
+	check_filters_support();
+}
+
+void Output_compression::check_correctness_of_related_config_fields( Config &conf )
+{
+    check_and_exit_if_not(
+	compression == "none" || compression == "deflate" || compression == "scale_offset",
+	"output_compression should be 'none', 'deflate' or 'scale_offset'" );
+    check_and_exit_if_not(
+	deflate_level >= 0 && deflate_level <= 9,
+	"deflate_level should be in range 0-9" );
+    check_and_exit_if_not(
+	scale_offset_decimal_digits >= 0,
+	"scale_offset_decimal_digits < 0" );
+}
+
+void Output_compression::check_filters_support()
+{
+    check_and_exit_if_not(
+	H5Zfilter_avail( H5Z_FILTER_DEFLATE ) > 0 &&
+	H5Zfilter_avail( H5Z_FILTER_SHUFFLE ) > 0 &&
+	H5Zfilter_avail( H5Z_FILTER_SCALEOFFSET ) > 0,
+	"HDF5 library is built without deflate, shuffle or scale-offset filter" );
+#if !H5_VERSION_GE( 1, 10, 2 )
+    int mpi_n_of_proc;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    check_and_exit_if_not(
+	mpi_n_of_proc == 1,
+	"compressed output from several processes requires HDF5 >= 1.10.2" );
+#endif
+}
+
+hid_t Output_compression::create_plist( int rank, const hsize_t *chunk_dims,
+					bool lossy_allowed )
+{
+    herr_t status;
+    hid_t create_plist = H5Pcreate( H5P_DATASET_CREATE );
+    hdf5_status_check( create_plist );
+    if( enabled ){
+	status = H5Pset_chunk( create_plist, rank, chunk_dims );
+	hdf5_status_check( status );
+	set_filters( create_plist, lossy_allowed );
+    }
+    return create_plist;
+}
+
+void Output_compression::set_filters( hid_t create_plist, bool lossy_allowed )
+{
+    herr_t status;
+    if( !enabled )
+	return;
+    if( compression == "scale_offset" && lossy_allowed ){
+	status = H5Pset_scaleoffset( create_plist, H5Z_SO_FLOAT_DSCALE,
+				     scale_offset_decimal_digits );
+	hdf5_status_check( status );
+    } else {
+	status = H5Pset_shuffle( create_plist ); hdf5_status_check( status );
+	status = H5Pset_deflate( create_plist, deflate_level ); hdf5_status_check( status );
+    }
+}
+
+void Output_compression::check_and_exit_if_not( const bool &should_be, const std::string &message )
+{
+    if( !should_be ){
+	std::cout << "Error: " + message << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    return;
+}
+
+void Output_compression::hdf5_status_check( herr_t status )
+{
+    if( status < 0 ){
+	std::cout << "Something went wrong while setting output compression. Aborting."
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef _OUTPUT_COMPRESSION_H_
+#define _OUTPUT_COMPRESSION_H_
+
+#include <iostream>
+#include <string>
+#include <mpi.h>
+#include <hdf5.h>
+#include <petscsys.h>
+#include "config.h"
+
+// Chunked layout and filters of output datasets.
+// 'deflate': shuffle + deflate for all datasets.
+// 'scale_offset': lossy scale-offset filter, keeping given number
+// of decimal digits after the point, for potential and electric field;
+// other datasets, including charge density, are compressed
+// by shuffle + deflate.
+// Filters in parallel HDF5 need collective writes and HDF5 >= 1.10.2.
+class Output_compression {
+  public:
+    bool enabled;
+    std::string compression;
+    int deflate_level;
+    int scale_offset_decimal_digits;
+  public:
+    Output_compression( Config &conf );
+    // Dataset creation property list; chunked and filtered
+    // if compression is enabled, contiguous otherwise.
+    // Has to be closed by the caller.
+    hid_t create_plist( int rank, const hsize_t *chunk_dims, bool lossy_allowed );
+    // Add filters to a chunked dataset creation property list.
+    void set_filters( hid_t create_plist, bool lossy_allowed );
+    virtual ~Output_compression() {};
+  private:
+    void check_correctness_of_related_config_fields( Config &conf );
+    void check_filters_support();
+    void check_and_exit_if_not( const bool &should_be, const std::string &message );
+    void hdf5_status_check( herr_t status );
+};
+
+#endif /* _OUTPUT_COMPRESSION_H_ */
@@ -1,16 +1,26 @@
 #include "parse_cmd_line.h"
 namespace po = boost::program_options;
 
-void parse_cmd_line( int argc, char *argv[], std::string &config_file )
+void parse_cmd_line( int argc, char *argv[], std::vector<std::string> &config_files,
+		     std::string &checkpoint_file, std::string &sweep_file,
+		     int &n_of_groups )
 {
     try {
         po::options_description cmd_line_options("Allowed options");
         cmd_line_options.add_options()
-            ("help,h", "produce help message");
+            ("help,h", "produce help message")
+	    ("restart,r", po::value< std::string >(),
+	     "continue simulation from output file written by previous run")
+	    ("sweep,s", po::value< std::string >(),
+	     "run config for each line of electrode potentials table in file")
+	    ("groups,g", po::value< int >()->default_value( 0 ),
+	     "split processes into this number of groups, each running its share "
+	     "of config files or sweep table lines; "
+	     "by default one group per config file, as far as processes suffice");
 	
 	po::options_description positional_parameters;
 	positional_parameters.add_options()
-	    ("config", po::value< std::vector<std::string> >(), "specify config file");
+	    ("config", po::value< std::vector<std::string> >(), "specify config files");
 	po::positional_options_description p;	
 	p.add("config", -1);
 
@@ -28,24 +38,48 @@ void parse_cmd_line( int argc, char *argv[], std::string &config_file )
 
         if ( vm.count("help") ) {
 	    std::cout << "Particle-in-cell simulation program." << std::endl;
-	    std::cout << "Usage: ./ef [OPTIONS] config-file" << std::endl;
+	    std::cout << "Usage: ./ef [OPTIONS] config-file [config-file ...]" << std::endl;
             std::cout << visible_options << "\n";
             exit( EXIT_FAILURE );
         }
         if ( vm.count("config" ) ) {
-	    std::vector<std::string> all_positional_args = vm["config"].as< std::vector<std::string> >();
-	    //if ( all_positional_args.size() > 1 ) {
-	    //std::cout << "Single config file is expected. \n";
-	    //	exit( EXIT_FAILURE );
-	    //}
-	    //config_file = all_positional_args.at(0);
-	    config_file = all_positional_args.back();
-            std::cout << "Config file is " << config_file << std::endl;
+	    config_files = vm["config"].as< std::vector<std::string> >();
+	    for ( auto &config_file : config_files )
+		std::cout << "Config file is " << config_file << std::endl;
         } else {
 	    std::cout << "Error: config file is not specified." << std::endl;
 	    std::cout << "See './ef -h' for usage info." << std::endl;
             exit( EXIT_FAILURE );
         }
+        n_of_groups = vm["groups"].as< int >();
+	if ( n_of_groups < 0 ) {
+	    std::cout << "Error: number of groups can't be negative." << std::endl;
+	    exit( EXIT_FAILURE );
+	}
+        if ( vm.count("restart") ) {
+	    if ( config_files.size() > 1 ) {
+		std::cout << "Error: restart requires a single config file." << std::endl;
+		exit( EXIT_FAILURE );
+	    }
+	    checkpoint_file = vm["restart"].as< std::string >();
+            std::cout << "Restart from " << checkpoint_file << std::endl;
+        }
+        if ( vm.count("sweep") ) {
+	    sweep_file = vm["sweep"].as< std::string >();
+            std::cout << "Sweep over electrode potentials from " << sweep_file << std::endl;
+	    if ( vm.count("restart") ) {
+		std::cout << "Error: restart and sweep can't be combined." << std::endl;
+		exit( EXIT_FAILURE );
+	    }
+	    if ( config_files.size() > 1 ) {
+		std::cout << "Error: sweep requires a single config file." << std::endl;
+		exit( EXIT_FAILURE );
+	    }
+        }
+        if ( n_of_groups > 1 && config_files.size() == 1 && sweep_file.empty() ) {
+	    std::cout << "Error: several groups require several config files or sweep." << std::endl;
+	    exit( EXIT_FAILURE );
+        }
     }
     catch( std::exception& e ) {
         std::cerr << "error: " << e.what() << "\n";
@@ -4,7 +4,10 @@
 #include <boost/program_options.hpp>
 #include <iostream>
 #include <string>
+#include <vector>
     
-void parse_cmd_line( int argc, char *argv[], std::string &config_file );
+void parse_cmd_line( int argc, char *argv[], std::vector<std::string> &config_files,
+		     std::string &checkpoint_file, std::string &sweep_file,
+		     int &n_of_groups );
 
 #endif /* _PARSE_CMD_LINE_H_ */
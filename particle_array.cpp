@@ -0,0 +1,158 @@
+#include "particle_array.h"
+
+void Particle_array::reserve( size_t n )
+{
+    if( n <= capacity() )
+	return;
+    n_of_reallocations++;
+    peak_capacity = std::max( peak_capacity, n );
+    id.reserve( n );
+    x.reserve( n );
+    y.reserve( n );
+    z.reserve( n );
+    px.reserve( n );
+    py.reserve( n );
+    pz.reserve( n );
+    momentum_is_half_time_step_shifted.reserve( n );
+}
+
+void Particle_array::clear()
+{
+    resize( 0 );
+}
+
+void Particle_array::ensure_capacity( size_t n )
+{
+    if( n > capacity() )
+	reserve( std::max( n, capacity() + capacity() / 2 ) );
+}
+
+void Particle_array::resize( size_t n )
+{
+    ensure_capacity( n );
+    id.resize( n );
+    x.resize( n );
+    y.resize( n );
+    z.resize( n );
+    px.resize( n );
+    py.resize( n );
+    pz.resize( n );
+    momentum_is_half_time_step_shifted.resize( n );
+}
+
+void Particle_array::append( int particle_id, Vec3d position, Vec3d momentum )
+{
+    ensure_capacity( size() + 1 );
+    id.push_back( particle_id );
+    x.push_back( vec3d_x( position ) );
+    y.push_back( vec3d_y( position ) );
+    z.push_back( vec3d_z( position ) );
+    px.push_back( vec3d_x( momentum ) );
+    py.push_back( vec3d_y( momentum ) );
+    pz.push_back( vec3d_z( momentum ) );
+    momentum_is_half_time_step_shifted.push_back( false );
+}
+
+size_t Particle_array::grow( size_t n )
+{
+    size_t first = size();
+    resize( first + n );
+    return first;
+}
+
+void Particle_array::set( size_t i, int particle_id, Vec3d position, Vec3d momentum )
+{
+    id[i] = particle_id;
+    x[i] = vec3d_x( position );
+    y[i] = vec3d_y( position );
+    z[i] = vec3d_z( position );
+    px[i] = vec3d_x( momentum );
+    py[i] = vec3d_y( momentum );
+    pz[i] = vec3d_z( momentum );
+    momentum_is_half_time_step_shifted[i] = false;
+}
+
+void Particle_array::set_momentum( size_t i, Vec3d mom )
+{
+    px[i] = vec3d_x( mom );
+    py[i] = vec3d_y( mom );
+    pz[i] = vec3d_z( mom );
+}
+
+void Particle_array::update_positions( double dt )
+{
+    size_t n = size();
+    double dt_over_mass = dt / mass;
+    double *xp = x.data(), *yp = y.data(), *zp = z.data();
+    const double *pxp = px.data(), *pyp = py.data(), *pzp = pz.data();
+    for( size_t i = 0; i < n; i++ ){
+	xp[i] += pxp[i] * dt_over_mass;
+	yp[i] += pyp[i] * dt_over_mass;
+	zp[i] += pzp[i] * dt_over_mass;
+    }
+}
+
+void Particle_array::move_particle( size_t from, size_t to )
+{
+    id[to] = id[from];
+    x[to] = x[from];
+    y[to] = y[from];
+    z[to] = z[from];
+    px[to] = px[from];
+    py[to] = py[from];
+    pz[to] = pz[from];
+    momentum_is_half_time_step_shifted[to] = momentum_is_half_time_step_shifted[from];
+}
+
+void Particle_array::permute( const std::vector<size_t> &new_position )
+{
+    std::vector<double> &buffer = permutation_buffer.values;
+    if( buffer.capacity() < size() ){
+	// Grows together with particle arrays
+	n_of_reallocations++;
+	buffer.reserve( capacity() );
+    }
+    buffer.resize( size() );
+    permute_values( id, new_position );
+    permute_values( x, new_position );
+    permute_values( y, new_position );
+    permute_values( z, new_position );
+    permute_values( px, new_position );
+    permute_values( py, new_position );
+    permute_values( pz, new_position );
+    permute_values( momentum_is_half_time_step_shifted, new_position );
+}
+
+void Particle_array::print( size_t i )
+{
+    std::cout.setf( std::ios::scientific );
+    std::cout.precision( 3 );
+    std::cout << "Particle: ";
+    std::cout << "id: " << id[i] << ", ";
+    std::cout << "charge = " << charge << " mass = " << mass << ", ";
+    std::cout << "pos(x,y,z) = ("
+	      << x[i] << ", "
+	      << y[i] << ", "
+	      << z[i] << "), ";
+    std::cout << "momentum(px,py,pz) = ("
+	      << px[i] << ", "
+	      << py[i] << ", "
+	      << pz[i] << ")";
+    std::cout << std::endl;
+    return;
+}
+
+void Particle_array::print_short( size_t i )
+{
+    std::cout.setf( std::ios::scientific );
+    std::cout.precision( 2 );
+    std::cout << "id: " << id[i] << " "
+	      << "x = " << x[i] << " "
+	      << "y = " << y[i] << " "
+	      << "z = " << z[i] << " "
+	      << "px = " << px[i] << " "
+	      << "py = " << py[i] << " "
+	      << "pz = " << pz[i] << " "
+	      << std::endl;
+    return;
+}
@@ -0,0 +1,114 @@
+#ifndef _PARTICLE_ARRAY_H_
+#define _PARTICLE_ARRAY_H_
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include "vec3d.h"
+
+// Structure-of-arrays storage for particles of a single species.
+// Charge and mass are the same for all particles of a source and
+// are kept once per array instead of once per particle.
+// Coordinates and momenta are stored in separate contiguous arrays
+// so that push and deposition loops stream only the data they need.
+// Storage is kept at its high-water capacity: removal compacts
+// particles in place and never releases memory, and growth reserves
+// with headroom, so that bursty injection doesn't reallocate each step.
+// Permutation goes through a scratch buffer which is kept as well.
+class Particle_array {
+public:
+    double charge;
+    double mass;
+    std::vector<int> id;
+    std::vector<double> x, y, z;
+    std::vector<double> px, py, pz;
+    std::vector<char> momentum_is_half_time_step_shifted;
+    // Storage statistics
+    long n_of_reallocations;
+    size_t peak_capacity;
+public:
+    Particle_array() :
+	charge( 0.0 ), mass( 0.0 ), n_of_reallocations( 0 ), peak_capacity( 0 ) {};
+    Particle_array( double charge, double mass ) :
+	charge( charge ), mass( mass ), n_of_reallocations( 0 ), peak_capacity( 0 ) {};
+    virtual ~Particle_array() {};
+    size_t size() const { return id.size(); };
+    bool empty() const { return id.empty(); };
+    size_t capacity() const { return id.capacity(); };
+    size_t peak_memory() const {
+	return peak_capacity * bytes_per_particle() +
+	    permutation_buffer.values.capacity() * sizeof( double );
+    };
+    static size_t bytes_per_particle() {
+	return sizeof( int ) + 6 * sizeof( double ) + sizeof( char );
+    };
+    void reserve( size_t n );
+    // New particles have to be filled with 'set' or read from file.
+    void resize( size_t n );
+    void clear();
+    void append( int particle_id, Vec3d position, Vec3d momentum );
+    // Adds 'n' particles at the end and returns index of the first one;
+    // their values have to be filled with 'set'.
+    size_t grow( size_t n );
+    void set( size_t i, int particle_id, Vec3d position, Vec3d momentum );
+    Vec3d position( size_t i ) const { return vec3d_init( x[i], y[i], z[i] ); };
+    Vec3d momentum( size_t i ) const { return vec3d_init( px[i], py[i], pz[i] ); };
+    void set_momentum( size_t i, Vec3d mom );
+    void update_positions( double dt );
+    void print( size_t i );
+    void print_short( size_t i );
+    // Stable in-place compaction: particles for which
+    // 'should_be_removed( i )' returns true are dropped,
+    // order of remaining particles is preserved.
+    template< typename Predicate >
+    size_t remove_if( Predicate should_be_removed );
+    // Particle 'i' is moved to position 'new_position[i]';
+    // 'new_position' has to be a permutation of 0..size()-1.
+    void permute( const std::vector<size_t> &new_position );
+private:
+    // Not copied with the array: snapshot copies are never permuted.
+    struct Permutation_buffer {
+	std::vector<double> values;
+	Permutation_buffer() {};
+	Permutation_buffer( const Permutation_buffer & ) {};
+	Permutation_buffer &operator=( const Permutation_buffer & ) { return *this; };
+    } permutation_buffer;
+    void move_particle( size_t from, size_t to );
+    void ensure_capacity( size_t n );
+    template< typename T >
+    void permute_values( std::vector<T> &values, const std::vector<size_t> &new_position );
+};
+
+
+template< typename Predicate >
+size_t Particle_array::remove_if( Predicate should_be_removed )
+{
+    size_t n = size();
+    size_t kept = 0;
+    for( size_t i = 0; i < n; i++ ){
+	if( should_be_removed( i ) )
+	    continue;
+	if( kept != i )
+	    move_particle( i, kept );
+	kept++;
+    }
+    resize( kept );
+    return n - kept;
+}
+
+template< typename T >
+void Particle_array::permute_values( std::vector<T> &values,
+				     const std::vector<size_t> &new_position )
+{
+    // Ids and flags are exactly representable as double,
+    // so one buffer serves all arrays.
+    std::vector<double> &permuted = permutation_buffer.values;
+    size_t n = values.size();
+    for( size_t i = 0; i < n; i++ )
+	permuted[ new_position[i] ] = values[i];
+    for( size_t i = 0; i < n; i++ )
+	values[i] = permuted[i];
+}
+
+#endif /* _PARTICLE_ARRAY_H_ */
@@ -0,0 +1,475 @@
+#include "particle_pusher.h"
+
+#if defined(__x86_64__) && ( defined(__GNUC__) || defined(__clang__) )
+#define EF_X86_SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Node (i,j,k) of Spatial_mesh::electric_field starts at
+// field[ i * node_stride_i + j * node_stride_j + k * 3 ].
+static_assert( sizeof( Vec3d ) == 3 * sizeof( double ),
+	       "Vec3d is expected to be three packed doubles" );
+
+static inline void interpolate_fields( const Push_kernel_args &a, size_t p,
+				       double *e_field, double *b_field )
+{
+    const int si = a.node_stride_i;
+    const int sj = a.node_stride_j;
+    const int sk = 3;
+    {
+	// next_node_num_and_weight
+	double xg = a.x[p] / a.dx;
+	double yg = a.y[p] / a.dy;
+	double zg = a.z[p] / a.dz;
+	int tlf_i = ceil( xg );
+	int tlf_j = ceil( yg );
+	int tlf_k = ceil( zg );
+	double wx = 1.0 - ( tlf_i - xg );
+	double wy = 1.0 - ( tlf_j - yg );
+	double wz = 1.0 - ( tlf_k - zg );
+	double mwx = 1.0 - wx;
+	double mwy = 1.0 - wy;
+	double mwz = 1.0 - wz;
+	// tlf, trf, blf, brf, tln, trn, bln, brn
+	const int offset[8] = { 0, -si, -sj, -si - sj,
+				-sk, -si - sk, -sj - sk, -si - sj - sk };
+	const double weight_x[8] = { wx, mwx, wx, mwx, wx, mwx, wx, mwx };
+	const double weight_y[8] = { wy, wy, mwy, mwy, wy, wy, mwy, mwy };
+	const double weight_z[8] = { wz, wz, wz, wz, mwz, mwz, mwz, mwz };
+	const double *node = a.field + tlf_i * si + tlf_j * sj + tlf_k * sk;
+	double ex = 0.0, ey = 0.0, ez = 0.0;
+	double bx = 0.0, by = 0.0, bz = 0.0;
+	if( a.magnetic_field == nullptr ){
+	    for( int c = 0; c < 8; c++ ){
+		const double *e = node + offset[c];
+		ex += e[0] * weight_x[c] * weight_y[c] * weight_z[c];
+		ey += e[1] * weight_x[c] * weight_y[c] * weight_z[c];
+		ez += e[2] * weight_x[c] * weight_y[c] * weight_z[c];
+	    }
+	} else {
+	    const double *b_node = a.magnetic_field + ( node - a.field );
+	    for( int c = 0; c < 8; c++ ){
+		const double *e = node + offset[c];
+		const double *b = b_node + offset[c];
+		ex += e[0] * weight_x[c] * weight_y[c] * weight_z[c];
+		ey += e[1] * weight_x[c] * weight_y[c] * weight_z[c];
+		ez += e[2] * weight_x[c] * weight_y[c] * weight_z[c];
+		bx += b[0] * weight_x[c] * weight_y[c] * weight_z[c];
+		by += b[1] * weight_x[c] * weight_y[c] * weight_z[c];
+		bz += b[2] * weight_x[c] * weight_y[c] * weight_z[c];
+	    }
+	}
+	e_field[0] = ex;
+	e_field[1] = ey;
+	e_field[2] = ez;
+	b_field[0] = a.bx + bx;
+	b_field[1] = a.by + by;
+	b_field[2] = a.bz + bz;
+    }
+}
+
+// Boris rotation vectors t = q B / ( m c ) * dt / 2 and s = 2 t / ( 1 + t^2 )
+static inline void boris_rotation_vectors( const double *b, double scale,
+					   double *t, double *s )
+{
+    t[0] = b[0] * scale;
+    t[1] = b[1] * scale;
+    t[2] = b[2] * scale;
+    const double t_squared = t[0] * t[0] + t[1] * t[1] + t[2] * t[2];
+    s[0] = 2.0 * t[0] / ( 1.0 + t_squared );
+    s[1] = 2.0 * t[1] / ( 1.0 + t_squared );
+    s[2] = 2.0 * t[2] / ( 1.0 + t_squared );
+}
+
+static inline void push_scalar_range( const Push_kernel_args &a, size_t begin, size_t end )
+{
+    for( size_t p = begin; p < end; p++ ){
+	double e[3], b[3];
+	interpolate_fields( a, p, e, b );
+	// forces
+	double fx = e[0] * a.charge + ( a.py[p] * b[2] - a.pz[p] * b[1] ) * a.mgn_scale;
+	double fy = e[1] * a.charge + ( a.pz[p] * b[0] - a.px[p] * b[2] ) * a.mgn_scale;
+	double fz = e[2] * a.charge + ( a.px[p] * b[1] - a.py[p] * b[0] ) * a.mgn_scale;
+	// momentum and position
+	a.px[p] += fx * a.dt;
+	a.py[p] += fy * a.dt;
+	a.pz[p] += fz * a.dt;
+	a.x[p] += a.px[p] * a.dt_over_mass;
+	a.y[p] += a.py[p] * a.dt_over_mass;
+	a.z[p] += a.pz[p] * a.dt_over_mass;
+    }
+}
+
+static void push_scalar( const Push_kernel_args &a, size_t n )
+{
+    push_scalar_range( a, 0, n );
+}
+
+// Boris scheme: half electric impulse, rotation in magnetic field,
+// second half electric impulse. Rotation preserves magnitude of momentum
+// exactly, so gyration stays stable for omega_c * dt of order 1.
+static void push_boris( const Push_kernel_args &a, size_t n )
+{
+    const double half_dt = a.dt / 2;
+    const double rotation_scale = a.mgn_scale * half_dt;
+    double t[3], s[3];
+    const double uniform_b[3] = { a.bx, a.by, a.bz };
+    boris_rotation_vectors( uniform_b, rotation_scale, t, s );
+    for( size_t p = 0; p < n; p++ ){
+	double e[3], b[3];
+	interpolate_fields( a, p, e, b );
+	if( a.magnetic_field != nullptr ){
+	    boris_rotation_vectors( b, rotation_scale, t, s );
+	}
+	const double tx = t[0], ty = t[1], tz = t[2];
+	const double sx = s[0], sy = s[1], sz = s[2];
+	double impulse_x = e[0] * a.charge * half_dt;
+	double impulse_y = e[1] * a.charge * half_dt;
+	double impulse_z = e[2] * a.charge * half_dt;
+	// p_minus = p + q E dt / 2
+	double mx = a.px[p] + impulse_x;
+	double my = a.py[p] + impulse_y;
+	double mz = a.pz[p] + impulse_z;
+	// p_prime = p_minus + p_minus x t
+	double qx = mx + ( my * tz - mz * ty );
+	double qy = my + ( mz * tx - mx * tz );
+	double qz = mz + ( mx * ty - my * tx );
+	// p_plus = p_minus + p_prime x s
+	a.px[p] = mx + ( qy * sz - qz * sy ) + impulse_x;
+	a.py[p] = my + ( qz * sx - qx * sz ) + impulse_y;
+	a.pz[p] = mz + ( qx * sy - qy * sx ) + impulse_z;
+	a.x[p] += a.px[p] * a.dt_over_mass;
+	a.y[p] += a.py[p] * a.dt_over_mass;
+	a.z[p] += a.pz[p] * a.dt_over_mass;
+    }
+}
+
+
+#ifdef EF_X86_SIMD_DISPATCH
+
+// Multiplications and additions are kept separate (no FMA)
+// to reproduce rounding of the scalar kernel.
+// Compiler must not contract them either: see FPFLAGS in Makefile.
+
+__attribute__(( target( "avx2" ) ))
+static void push_avx2( const Push_kernel_args &a, size_t n )
+{
+    const size_t width = 4;
+    const size_t n_vec = n - n % width;
+    const __m256d one = _mm256_set1_pd( 1.0 );
+    const __m256d dx = _mm256_set1_pd( a.dx );
+    const __m256d dy = _mm256_set1_pd( a.dy );
+    const __m256d dz = _mm256_set1_pd( a.dz );
+    const __m256d charge = _mm256_set1_pd( a.charge );
+    const __m256d mgn_scale = _mm256_set1_pd( a.mgn_scale );
+    const __m256d bx = _mm256_set1_pd( a.bx );
+    const __m256d by = _mm256_set1_pd( a.by );
+    const __m256d bz = _mm256_set1_pd( a.bz );
+    const __m256d dt = _mm256_set1_pd( a.dt );
+    const __m256d dt_over_mass = _mm256_set1_pd( a.dt_over_mass );
+    const __m128i si = _mm_set1_epi32( a.node_stride_i );
+    const __m128i sj = _mm_set1_epi32( a.node_stride_j );
+    const __m128i sk = _mm_set1_epi32( 3 );
+    const int off[8] = { 0, -a.node_stride_i, -a.node_stride_j,
+			 -a.node_stride_i - a.node_stride_j,
+			 -3, -a.node_stride_i - 3, -a.node_stride_j - 3,
+			 -a.node_stride_i - a.node_stride_j - 3 };
+
+    for( size_t p = 0; p < n_vec; p += width ){
+	__m256d x = _mm256_loadu_pd( a.x + p );
+	__m256d y = _mm256_loadu_pd( a.y + p );
+	__m256d z = _mm256_loadu_pd( a.z + p );
+	__m256d xg = _mm256_div_pd( x, dx );
+	__m256d yg = _mm256_div_pd( y, dy );
+	__m256d zg = _mm256_div_pd( z, dz );
+	__m256d ci = _mm256_round_pd( xg, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC );
+	__m256d cj = _mm256_round_pd( yg, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC );
+	__m256d ck = _mm256_round_pd( zg, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC );
+	__m256d wx = _mm256_sub_pd( one, _mm256_sub_pd( ci, xg ) );
+	__m256d wy = _mm256_sub_pd( one, _mm256_sub_pd( cj, yg ) );
+	__m256d wz = _mm256_sub_pd( one, _mm256_sub_pd( ck, zg ) );
+	__m256d mwx = _mm256_sub_pd( one, wx );
+	__m256d mwy = _mm256_sub_pd( one, wy );
+	__m256d mwz = _mm256_sub_pd( one, wz );
+	__m128i node = _mm_add_epi32(
+	    _mm_add_epi32( _mm_mullo_epi32( _mm256_cvttpd_epi32( ci ), si ),
+			   _mm_mullo_epi32( _mm256_cvttpd_epi32( cj ), sj ) ),
+	    _mm_mullo_epi32( _mm256_cvttpd_epi32( ck ), sk ) );
+	const __m256d weight_x[8] = { wx, mwx, wx, mwx, wx, mwx, wx, mwx };
+	const __m256d weight_y[8] = { wy, wy, mwy, mwy, wy, wy, mwy, mwy };
+	const __m256d weight_z[8] = { wz, wz, wz, wz, mwz, mwz, mwz, mwz };
+
+	__m256d ex = _mm256_setzero_pd();
+	__m256d ey = _mm256_setzero_pd();
+	__m256d ez = _mm256_setzero_pd();
+	for( int c = 0; c < 8; c++ ){
+	    __m128i idx = _mm_add_epi32( node, _mm_set1_epi32( off[c] ) );
+	    __m256d e0 = _mm256_i32gather_pd( a.field, idx, 8 );
+	    __m256d e1 = _mm256_i32gather_pd( a.field + 1, idx, 8 );
+	    __m256d e2 = _mm256_i32gather_pd( a.field + 2, idx, 8 );
+	    e0 = _mm256_mul_pd( _mm256_mul_pd( _mm256_mul_pd( e0, weight_x[c] ),
+					       weight_y[c] ), weight_z[c] );
+	    e1 = _mm256_mul_pd( _mm256_mul_pd( _mm256_mul_pd( e1, weight_x[c] ),
+					       weight_y[c] ), weight_z[c] );
+	    e2 = _mm256_mul_pd( _mm256_mul_pd( _mm256_mul_pd( e2, weight_x[c] ),
+					       weight_y[c] ), weight_z[c] );
+	    ex = _mm256_add_pd( ex, e0 );
+	    ey = _mm256_add_pd( ey, e1 );
+	    ez = _mm256_add_pd( ez, e2 );
+	}
+
+	__m256d px = _mm256_loadu_pd( a.px + p );
+	__m256d py = _mm256_loadu_pd( a.py + p );
+	__m256d pz = _mm256_loadu_pd( a.pz + p );
+	__m256d fx = _mm256_add_pd(
+	    _mm256_mul_pd( ex, charge ),
+	    _mm256_mul_pd( _mm256_sub_pd( _mm256_mul_pd( py, bz ), _mm256_mul_pd( pz, by ) ),
+			   mgn_scale ) );
+	__m256d fy = _mm256_add_pd(
+	    _mm256_mul_pd( ey, charge ),
+	    _mm256_mul_pd( _mm256_sub_pd( _mm256_mul_pd( pz, bx ), _mm256_mul_pd( px, bz ) ),
+			   mgn_scale ) );
+	__m256d fz = _mm256_add_pd(
+	    _mm256_mul_pd( ez, charge ),
+	    _mm256_mul_pd( _mm256_sub_pd( _mm256_mul_pd( px, by ), _mm256_mul_pd( py, bx ) ),
+			   mgn_scale ) );
+	px = _mm256_add_pd( px, _mm256_mul_pd( fx, dt ) );
+	py = _mm256_add_pd( py, _mm256_mul_pd( fy, dt ) );
+	pz = _mm256_add_pd( pz, _mm256_mul_pd( fz, dt ) );
+	_mm256_storeu_pd( a.px + p, px );
+	_mm256_storeu_pd( a.py + p, py );
+	_mm256_storeu_pd( a.pz + p, pz );
+	_mm256_storeu_pd( a.x + p, _mm256_add_pd( x, _mm256_mul_pd( px, dt_over_mass ) ) );
+	_mm256_storeu_pd( a.y + p, _mm256_add_pd( y, _mm256_mul_pd( py, dt_over_mass ) ) );
+	_mm256_storeu_pd( a.z + p, _mm256_add_pd( z, _mm256_mul_pd( pz, dt_over_mass ) ) );
+    }
+    push_scalar_range( a, n_vec, n );
+}
+
+
+__attribute__(( target( "avx512f" ) ))
+static void push_avx512( const Push_kernel_args &a, size_t n )
+{
+    const size_t width = 8;
+    const size_t n_vec = n - n % width;
+    const __m512d one = _mm512_set1_pd( 1.0 );
+    const __m512d dx = _mm512_set1_pd( a.dx );
+    const __m512d dy = _mm512_set1_pd( a.dy );
+    const __m512d dz = _mm512_set1_pd( a.dz );
+    const __m512d charge = _mm512_set1_pd( a.charge );
+    const __m512d mgn_scale = _mm512_set1_pd( a.mgn_scale );
+    const __m512d bx = _mm512_set1_pd( a.bx );
+    const __m512d by = _mm512_set1_pd( a.by );
+    const __m512d bz = _mm512_set1_pd( a.bz );
+    const __m512d dt = _mm512_set1_pd( a.dt );
+    const __m512d dt_over_mass = _mm512_set1_pd( a.dt_over_mass );
+    const __m256i si = _mm256_set1_epi32( a.node_stride_i );
+    const __m256i sj = _mm256_set1_epi32( a.node_stride_j );
+    const __m256i sk = _mm256_set1_epi32( 3 );
+    const int off[8] = { 0, -a.node_stride_i, -a.node_stride_j,
+			 -a.node_stride_i - a.node_stride_j,
+			 -3, -a.node_stride_i - 3, -a.node_stride_j - 3,
+			 -a.node_stride_i - a.node_stride_j - 3 };
+
+    for( size_t p = 0; p < n_vec; p += width ){
+	__m512d x = _mm512_loadu_pd( a.x + p );
+	__m512d y = _mm512_loadu_pd( a.y + p );
+	__m512d z = _mm512_loadu_pd( a.z + p );
+	__m512d xg = _mm512_div_pd( x, dx );
+	__m512d yg = _mm512_div_pd( y, dy );
+	__m512d zg = _mm512_div_pd( z, dz );
+	__m512d ci = _mm512_roundscale_pd( xg, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC );
+	__m512d cj = _mm512_roundscale_pd( yg, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC );
+	__m512d ck = _mm512_roundscale_pd( zg, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC );
+	__m512d wx = _mm512_sub_pd( one, _mm512_sub_pd( ci, xg ) );
+	__m512d wy = _mm512_sub_pd( one, _mm512_sub_pd( cj, yg ) );
+	__m512d wz = _mm512_sub_pd( one, _mm512_sub_pd( ck, zg ) );
+	__m512d mwx = _mm512_sub_pd( one, wx );
+	__m512d mwy = _mm512_sub_pd( one, wy );
+	__m512d mwz = _mm512_sub_pd( one, wz );
+	__m256i node = _mm256_add_epi32(
+	    _mm256_add_epi32( _mm256_mullo_epi32( _mm512_cvttpd_epi32( ci ), si ),
+			      _mm256_mullo_epi32( _mm512_cvttpd_epi32( cj ), sj ) ),
+	    _mm256_mullo_epi32( _mm512_cvttpd_epi32( ck ), sk ) );
+	const __m512d weight_x[8] = { wx, mwx, wx, mwx, wx, mwx, wx, mwx };
+	const __m512d weight_y[8] = { wy, wy, mwy, mwy, wy, wy, mwy, mwy };
+	const __m512d weight_z[8] = { wz, wz, wz, wz, mwz, mwz, mwz, mwz };
+
+	__m512d ex = _mm512_setzero_pd();
+	__m512d ey = _mm512_setzero_pd();
+	__m512d ez = _mm512_setzero_pd();
+	for( int c = 0; c < 8; c++ ){
+	    __m256i idx = _mm256_add_epi32( node, _mm256_set1_epi32( off[c] ) );
+	    __m512d e0 = _mm512_i32gather_pd( idx, a.field, 8 );
+	    __m512d e1 = _mm512_i32gather_pd( idx, a.field + 1, 8 );
+	    __m512d e2 = _mm512_i32gather_pd( idx, a.field + 2, 8 );
+	    e0 = _mm512_mul_pd( _mm512_mul_pd( _mm512_mul_pd( e0, weight_x[c] ),
+					       weight_y[c] ), weight_z[c] );
+	    e1 = _mm512_mul_pd( _mm512_mul_pd( _mm512_mul_pd( e1, weight_x[c] ),
+					       weight_y[c] ), weight_z[c] );
+	    e2 = _mm512_mul_pd( _mm512_mul_pd( _mm512_mul_pd( e2, weight_x[c] ),
+					       weight_y[c] ), weight_z[c] );
+	    ex = _mm512_add_pd( ex, e0 );
+	    ey = _mm512_add_pd( ey, e1 );
+	    ez = _mm512_add_pd( ez, e2 );
+	}
+
+	__m512d px = _mm512_loadu_pd( a.px + p );
+	__m512d py = _mm512_loadu_pd( a.py + p );
+	__m512d pz = _mm512_loadu_pd( a.pz + p );
+	__m512d fx = _mm512_add_pd(
+	    _mm512_mul_pd( ex, charge ),
+	    _mm512_mul_pd( _mm512_sub_pd( _mm512_mul_pd( py, bz ), _mm512_mul_pd( pz, by ) ),
+			   mgn_scale ) );
+	__m512d fy = _mm512_add_pd(
+	    _mm512_mul_pd( ey, charge ),
+	    _mm512_mul_pd( _mm512_sub_pd( _mm512_mul_pd( pz, bx ), _mm512_mul_pd( px, bz ) ),
+			   mgn_scale ) );
+	__m512d fz = _mm512_add_pd(
+	    _mm512_mul_pd( ez, charge ),
+	    _mm512_mul_pd( _mm512_sub_pd( _mm512_mul_pd( px, by ), _mm512_mul_pd( py, bx ) ),
+			   mgn_scale ) );
+	px = _mm512_add_pd( px, _mm512_mul_pd( fx, dt ) );
+	py = _mm512_add_pd( py, _mm512_mul_pd( fy, dt ) );
+	pz = _mm512_add_pd( pz, _mm512_mul_pd( fz, dt ) );
+	_mm512_storeu_pd( a.px + p, px );
+	_mm512_storeu_pd( a.py + p, py );
+	_mm512_storeu_pd( a.pz + p, pz );
+	_mm512_storeu_pd( a.x + p, _mm512_add_pd( x, _mm512_mul_pd( px, dt_over_mass ) ) );
+	_mm512_storeu_pd( a.y + p, _mm512_add_pd( y, _mm512_mul_pd( py, dt_over_mass ) ) );
+	_mm512_storeu_pd( a.z + p, _mm512_add_pd( z, _mm512_mul_pd( pz, dt_over_mass ) ) );
+    }
+    push_scalar_range( a, n_vec, n );
+}
+
+#endif /* EF_X86_SIMD_DISPATCH */
+
+
+Particle_pusher::Particle_pusher( Config &conf )
+{
+    check_correctness_of_related_config_fields( conf );
+    boris = ( conf.particle_pusher_config_part.particle_pusher == "boris" );
+    magnetic_field_on_mesh =
+	!conf.external_magnetic_field_mesh_config_part.magnetic_field_mesh_filename.empty();
+    select_kernel();
+    int mpi_process_rank;
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+    if( mpi_process_rank == 0 ){
+	std::cout << "Particle push kernel: " << kernel_name() << std::endl;
+    }
+}
+
+void Particle_pusher::check_correctness_of_related_config_fields( Config &conf )
+{
+    std::string pusher = conf.particle_pusher_config_part.particle_pusher;
+    if( pusher != "leap_frog" && pusher != "boris" ){
+	std::cout << "Error: wrong value of 'particle_pusher': " + pusher << std::endl;
+	std::cout << "Allowed values : 'leap_frog', 'boris'" << std::endl;
+	std::cout << "Aborting" << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
+
+void Particle_pusher::select_kernel()
+{
+    kernel = scalar;
+    // Boris push and push in nonuniform magnetic field
+    // have scalar kernels only
+    if( boris || magnetic_field_on_mesh )
+	return;
+#ifdef EF_X86_SIMD_DISPATCH
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports( "avx512f" ) ){
+	kernel = avx512;
+    } else if( __builtin_cpu_supports( "avx2" ) ){
+	kernel = avx2;
+    }
+#endif
+}
+
+std::string Particle_pusher::kernel_name()
+{
+    if( boris )
+	return "boris";
+    switch( kernel ){
+    case avx512:
+	return "avx512";
+    case avx2:
+	return "avx2";
+    default:
+	return "scalar";
+    }
+}
+
+bool Particle_pusher::field_indices_fit_in_int( Spatial_mesh &spat_mesh )
+{
+    // Vector gathers use 32-bit offsets into the field array.
+    return 3.0 * spat_mesh.electric_field.num_elements() < (double)INT_MAX;
+}
+
+void Particle_pusher::push( Spatial_mesh &spat_mesh,
+			    External_magnetic_field &external_magnetic_field,
+			    Particle_array &particles,
+			    double dt )
+{
+    size_t n = particles.size();
+    if( n == 0 )
+	return;
+
+    Push_kernel_args a;
+    a.field = &( spat_mesh.electric_field.data()->x[0] );
+    a.node_stride_j = 3 * spat_mesh.z_n_nodes;
+    a.node_stride_i = a.node_stride_j * spat_mesh.y_n_nodes;
+    a.dx = spat_mesh.x_cell_size;
+    a.dy = spat_mesh.y_cell_size;
+    a.dz = spat_mesh.z_cell_size;
+    a.charge = particles.charge;
+    a.dt = dt;
+    a.dt_over_mass = dt / particles.mass;
+    a.mgn_scale = particles.charge / particles.mass / external_magnetic_field.speed_of_light;
+    a.bx = vec3d_x( external_magnetic_field.magnetic_field );
+    a.by = vec3d_y( external_magnetic_field.magnetic_field );
+    a.bz = vec3d_z( external_magnetic_field.magnetic_field );
+    a.magnetic_field = external_magnetic_field.magnetic_field_on_mesh;
+    a.x = particles.x.data();
+    a.y = particles.y.data();
+    a.z = particles.z.data();
+    a.px = particles.px.data();
+    a.py = particles.py.data();
+    a.pz = particles.pz.data();
+
+    if( boris ){
+	push_boris( a, n );
+	return;
+    }
+#ifdef EF_X86_SIMD_DISPATCH
+    if( field_indices_fit_in_int( spat_mesh ) && !external_magnetic_field.on_mesh() ){
+	if( kernel == avx512 ){
+	    push_avx512( a, n );
+	    return;
+	} else if( kernel == avx2 ){
+	    push_avx2( a, n );
+	    return;
+	}
+    }
+#endif
+    push_scalar( a, n );
+}
+
+Vec3d Particle_pusher::boris_momentum_update( Particle_array &particles, size_t i,
+					      Vec3d el_field_force,
+					      External_magnetic_field &external_magnetic_field,
+					      double dt )
+{
+    double scale = particles.charge / particles.mass
+	/ external_magnetic_field.speed_of_light * dt / 2;
+    Vec3d momentum = particles.momentum( i );
+    Vec3d t = vec3d_times_scalar( external_magnetic_field.field_at_particle( particles, i ),
+				  scale );
+    Vec3d s = vec3d_times_scalar( t, 2.0 / ( 1.0 + vec3d_dot_product( t, t ) ) );
+    Vec3d impulse = vec3d_times_scalar( el_field_force, dt / 2 );
+    Vec3d p_minus = vec3d_add( momentum, impulse );
+    Vec3d p_prime = vec3d_add( p_minus, vec3d_cross_product( p_minus, t ) );
+    Vec3d p_plus = vec3d_add( p_minus, vec3d_cross_product( p_prime, s ) );
+    return vec3d_add( p_plus, impulse );
+}
@@ -0,0 +1,68 @@
+#ifndef _PARTICLE_PUSHER_H_
+#define _PARTICLE_PUSHER_H_
+
+#include <iostream>
+#include <string>
+#include <climits>
+#include <cmath>
+#include <mpi.h>
+#include "config.h"
+#include "spatial_mesh.h"
+#include "External_magnetic_field.h"
+#include "particle_array.h"
+#include "vec3d.h"
+
+// Fused leap-frog push: field interpolation, electric and magnetic
+// forces, momentum and position update are done in one pass over
+// the particles of a source.
+// Magnetic field on mesh, if present, is interpolated together with
+// the electric field using the same nodes and weights.
+// Vectorized kernels for AVX-512 and AVX2 are selected at runtime
+// depending on CPU; otherwise scalar kernel is used.
+// All kernels perform floating point operations in the same order
+// as the scalar one, so results do not depend on the kernel choice.
+// Vectorized kernels assume uniform magnetic field.
+// Alternatively, Boris scheme can be selected in config;
+// it is done by a separate scalar kernel.
+
+struct Push_kernel_args {
+    const double *field;
+    int node_stride_i, node_stride_j;
+    double dx, dy, dz;
+    double charge;
+    double dt;
+    double dt_over_mass;
+    double mgn_scale;
+    double bx, by, bz;
+    // Same layout as 'field'; nullptr if magnetic field is uniform
+    const double *magnetic_field;
+    double *x, *y, *z;
+    double *px, *py, *pz;
+};
+
+class Particle_pusher {
+  public:
+    enum Kernel_type { scalar, avx2, avx512 };
+    Kernel_type kernel;
+    bool boris;
+    bool magnetic_field_on_mesh;
+  public:
+    Particle_pusher( Config &conf );
+    void push( Spatial_mesh &spat_mesh,
+	       External_magnetic_field &external_magnetic_field,
+	       Particle_array &particles,
+	       double dt );
+    std::string kernel_name();
+    // Momentum after time 'dt' by Boris scheme for a single particle;
+    // used to shift momentum half time step back.
+    Vec3d boris_momentum_update( Particle_array &particles, size_t i, Vec3d el_field_force,
+				 External_magnetic_field &external_magnetic_field,
+				 double dt );
+    virtual ~Particle_pusher() {};
+  private:
+    void check_correctness_of_related_config_fields( Config &conf );
+    void select_kernel();
+    bool field_indices_fit_in_int( Spatial_mesh &spat_mesh );
+};
+
+#endif /* _PARTICLE_PUSHER_H_ */
@@ -0,0 +1,145 @@
+#include "particle_sorter.h"
+
+Particle_sorter::Particle_sorter( Config &conf )
+{
+    sort_each_n_steps_ge_zero( conf );
+    sort_each_n_steps =
+	conf.particle_sorting_config_part.sort_particles_each_n_steps;
+    particles_sorted = 0;
+    same_cell_neighbours_before = 0;
+    same_cell_neighbours_after = 0;
+    sorts_done = 0;
+}
+
+bool Particle_sorter::time_to_sort( int current_time_node )
+{
+    return sorting_enabled() && ( current_time_node % sort_each_n_steps == 0 );
+}
+
+void Particle_sorter::sort( Spatial_mesh &spat_mesh,
+			    Particle_sources_manager &particle_sources )
+{
+    long long local_counters[3] = { 0, 0, 0 };
+    long long global_counters[3];
+
+    for( auto &src : particle_sources.sources ) {
+	local_counters[0] += src.particles.size();
+	sort_single_source( spat_mesh, src.particles,
+			    &local_counters[1], &local_counters[2] );
+    }
+
+    MPI_Allreduce( local_counters, global_counters, 3,
+		   MPI_LONG_LONG, MPI_SUM, PETSC_COMM_WORLD );
+    particles_sorted = global_counters[0];
+    same_cell_neighbours_before = global_counters[1];
+    same_cell_neighbours_after = global_counters[2];
+    sorts_done++;
+}
+
+void Particle_sorter::sort_single_source( Spatial_mesh &spat_mesh,
+					  Particle_array &particles,
+					  long long *same_cell_before,
+					  long long *same_cell_after )
+{
+    size_t n_of_particles = particles.size();
+    size_t n_of_cells = (size_t)spat_mesh.x_n_nodes *
+	spat_mesh.y_n_nodes * spat_mesh.z_n_nodes;
+
+    eval_cell_of_each_particle( spat_mesh, particles );
+    *same_cell_before += count_same_cell_neighbours();
+
+    // Counting sort: position of a particle is the number of particles
+    // in preceding cells plus number of particles of the same cell
+    // which come earlier; relative order inside a cell is kept.
+    particles_before_cell.assign( n_of_cells + 1, 0 );
+    for( size_t p = 0; p < n_of_particles; p++ )
+	particles_before_cell[ cell_of_particle[p] + 1 ]++;
+    for( size_t c = 1; c <= n_of_cells; c++ )
+	particles_before_cell[c] += particles_before_cell[c-1];
+    new_position.resize( n_of_particles );
+    for( size_t p = 0; p < n_of_particles; p++ )
+	new_position[p] = particles_before_cell[ cell_of_particle[p] ]++;
+
+    particles.permute( new_position );
+
+    eval_cell_of_each_particle( spat_mesh, particles );
+    *same_cell_after += count_same_cell_neighbours();
+}
+
+void Particle_sorter::eval_cell_of_each_particle( Spatial_mesh &spat_mesh,
+						  Particle_array &particles )
+{
+    int nx = spat_mesh.x_n_nodes;
+    int ny = spat_mesh.y_n_nodes;
+    int nz = spat_mesh.z_n_nodes;
+    double dx = spat_mesh.x_cell_size;
+    double dy = spat_mesh.y_cell_size;
+    double dz = spat_mesh.z_cell_size;
+
+    cell_of_particle.resize( particles.size() );
+    for( size_t p = 0; p < particles.size(); p++ ) {
+	int i = cell_index( particles.x[p], dx, nx );
+	int j = cell_index( particles.y[p], dy, ny );
+	int k = cell_index( particles.z[p], dz, nz );
+	cell_of_particle[p] = ( i * ny + j ) * nz + k;
+    }
+}
+
+int Particle_sorter::cell_index( double coord, double cell_size, int n_nodes )
+{
+    // Same node as in Particle_to_mesh_map::next_node_num_and_weight;
+    // clamped to the mesh for safety.
+    int node = (int)ceil( coord / cell_size );
+    if( node < 0 )
+	node = 0;
+    if( node > n_nodes - 1 )
+	node = n_nodes - 1;
+    return node;
+}
+
+long long Particle_sorter::count_same_cell_neighbours()
+{
+    long long same_cell = 0;
+    for( size_t p = 1; p < cell_of_particle.size(); p++ )
+	if( cell_of_particle[p] == cell_of_particle[p-1] )
+	    same_cell++;
+    return same_cell;
+}
+
+void Particle_sorter::print_locality_counters()
+{
+    int mpi_process_rank;
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+    if( mpi_process_rank != 0 || particles_sorted == 0 )
+	return;
+
+    std::ios::fmtflags flags( std::cout.flags() );
+    std::streamsize precision = std::cout.precision();
+    std::cout.precision( 3 );
+    std::cout << std::fixed;
+    std::cout << "Particle sorting: "
+	      << particles_sorted << " particles; "
+	      << "in the same cell as previous particle: "
+	      << 100.0 * same_cell_neighbours_before / particles_sorted << "% before, "
+	      << 100.0 * same_cell_neighbours_after / particles_sorted << "% after"
+	      << std::endl;
+    std::cout.flags( flags );
+    std::cout.precision( precision );
+}
+
+void Particle_sorter::sort_each_n_steps_ge_zero( Config &conf )
+{
+    check_and_exit_if_not(
+	conf.particle_sorting_config_part.sort_particles_each_n_steps >= 0,
+	"sort_particles_each_n_steps < 0" );
+}
+
+void Particle_sorter::check_and_exit_if_not( const bool &should_be,
+					     const std::string &message )
+{
+    if( !should_be ){
+	std::cout << "Error: " + message << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    return;
+}
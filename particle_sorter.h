@@ -0,0 +1,54 @@
+#ifndef _PARTICLE_SORTER_H_
+#define _PARTICLE_SORTER_H_
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <mpi.h>
+#include "config.h"
+#include "spatial_mesh.h"
+#include "particle_source.h"
+#include "particle_array.h"
+
+// Periodic reordering of particles by mesh cell.
+// Particles are counting-sorted by the index of the 'top-left-far' node
+// of the cell they are in; node index grows in the same order as
+// the mesh arrays are stored in memory. After sorting, consecutive
+// particles deposit charge to and gather field from the same or
+// neighbouring nodes, which keeps mesh data in cache.
+// Sorting changes only the order of particles, not their values.
+class Particle_sorter {
+  public:
+    int sort_each_n_steps;
+    // Locality counters: number of particles which are in the same
+    // cell as the preceding particle of the same source,
+    // summed over all processes; before and after the last sort.
+    long long particles_sorted;
+    long long same_cell_neighbours_before;
+    long long same_cell_neighbours_after;
+    int sorts_done;
+  public:
+    Particle_sorter( Config &conf );
+    bool sorting_enabled() { return sort_each_n_steps > 0; };
+    bool time_to_sort( int current_time_node );
+    void sort( Spatial_mesh &spat_mesh, Particle_sources_manager &particle_sources );
+    void print_locality_counters();
+    virtual ~Particle_sorter() {};
+  private:
+    std::vector<int> cell_of_particle;
+    std::vector<size_t> particles_before_cell;
+    std::vector<size_t> new_position;
+    // Sort
+    void sort_single_source( Spatial_mesh &spat_mesh, Particle_array &particles,
+			     long long *same_cell_before, long long *same_cell_after );
+    void eval_cell_of_each_particle( Spatial_mesh &spat_mesh, Particle_array &particles );
+    int cell_index( double coord, double cell_size, int n_nodes );
+    long long count_same_cell_neighbours();
+    // Config check
+    void sort_each_n_steps_ge_zero( Config &conf );
+    void check_and_exit_if_not( const bool &should_be, const std::string &message );
+};
+
+#endif /* _PARTICLE_SORTER_H_ */
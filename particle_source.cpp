@@ -3,12 +3,17 @@
 void check_and_warn_if_not( const bool &should_be, const std::string &message );
 void check_and_exit_if_not( const bool &should_be, const std::string &message );
 
+std::default_random_engine Particle_source::rest_distribution_rnd_gen;
+
 Particle_source::Particle_source( 
     Config &conf, 
-    Particle_source_config_part &src_conf )
+    Particle_source_config_part &src_conf ) :
+    compression( conf )
 {
     check_correctness_of_related_config_fields( conf, src_conf );
     set_parameters_from_config( src_conf );
+    single_precision_output =
+	( conf.output_layout_config_part.output_datatype == "float32" );
 }
 
 void Particle_source::check_correctness_of_related_config_fields( 
@@ -31,14 +36,15 @@ void Particle_source::set_parameters_from_config( Particle_source_config_part &s
 				src_conf.mean_momentum_y,
 				src_conf.mean_momentum_z );
     temperature = src_conf.temperature;
-    charge = src_conf.charge;
-    mass = src_conf.mass;    
+    // Particle characteristics
+    particles.charge = src_conf.charge;
+    particles.mass = src_conf.mass;
     // Random number generator
     // Simple approach: use different seed for each proccess.
     // Other way would be to synchronize the state of the rnd_gen
     //    between each processes after each call to it.    
     int mpi_process_rank;
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
     unsigned seed = 0 + 1000000 * mpi_process_rank;
     rnd_gen = std::default_random_engine( seed );
     // Initial id
@@ -47,13 +53,11 @@ void Particle_source::set_parameters_from_config( Particle_source_config_part &s
 
 void Particle_source::generate_initial_particles()
 {
-    //particles.reserve( initial_number_of_particles );
     generate_num_of_particles( initial_number_of_particles );
 }
 
 void Particle_source::generate_each_step()
 {
-    //particles.reserve( particles.size() + particles_to_generate_each_step );
     generate_num_of_particles( particles_to_generate_each_step );
 }
     
@@ -64,15 +68,17 @@ void Particle_source::generate_num_of_particles( int num_of_particles )
     int num_of_particles_for_this_proc;
 
     int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
 
     num_of_particles_for_this_proc = num_of_particles_for_each_process( num_of_particles );
     populate_vec_of_ids( vec_of_ids, num_of_particles_for_this_proc ); 
+    // New particles are written in place after the existing ones
+    size_t first = particles.grow( num_of_particles_for_this_proc );
     for ( int i = 0; i < num_of_particles_for_this_proc; i++ ) {
 	pos = uniform_position_in_source( rnd_gen );
-	mom = maxwell_momentum_distr( mean_momentum, temperature, mass, rnd_gen );
-	particles.emplace_back( vec_of_ids[i], charge, mass, pos, mom );
+	mom = maxwell_momentum_distr( mean_momentum, temperature, particles.mass, rnd_gen );
+	particles.set( first + i, vec_of_ids[i], pos, mom );
     }
 }
 
@@ -80,8 +86,8 @@ int Particle_source::num_of_particles_for_each_process( int total_num_of_particl
 {
     int rest;
     int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
     
     int num_of_particles_for_this_proc = total_num_of_particles / mpi_n_of_proc;
     rest = total_num_of_particles % mpi_n_of_proc;
@@ -91,8 +97,7 @@ int Particle_source::num_of_particles_for_each_process( int total_num_of_particl
     // 'total_num_of_particles' < 'mpi_n_of_proc'
     std::vector<int> proc_numbers( mpi_n_of_proc );
     std::iota( proc_numbers.begin(), proc_numbers.end(), 0 );
-    static auto engine = std::default_random_engine{};
-    std::shuffle( proc_numbers.begin(), proc_numbers.end(), engine );
+    std::shuffle( proc_numbers.begin(), proc_numbers.end(), rest_distribution_rnd_gen );
 
     for ( int i = 0; i < rest; i++ ) {
 	if( mpi_process_rank == proc_numbers[i] ){
@@ -107,8 +112,8 @@ void Particle_source::populate_vec_of_ids(
     std::vector<int> &vec_of_ids, int num_of_particles_for_this_proc )
 {
     int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
 
     vec_of_ids.reserve( num_of_particles_for_this_proc );
     
@@ -118,7 +123,7 @@ void Particle_source::populate_vec_of_ids(
 		vec_of_ids.push_back( max_id++ );
 	    }	    
 	}
-	MPI_Bcast( &max_id, 1, MPI_INT, proc, MPI_COMM_WORLD );
+	MPI_Bcast( &max_id, 1, MPI_INT, proc, PETSC_COMM_WORLD );
     }
 }
 
@@ -155,24 +160,55 @@ Vec3d Particle_source::maxwell_momentum_distr(
 
 void Particle_source::update_particles_position( double dt )
 {
-    for ( auto &p : particles )
-	p.update_position( dt );
+    particles.update_positions( dt );
 }
 
 
 void Particle_source::print_particles()
 {
     std::cout << "Source name: " << name << std::endl;
-    for ( auto& p : particles  ) {	
-	p.print_short();
+    for ( size_t i = 0; i < particles.size(); i++ ) {
+	particles.print_short( i );
     }
     return;
 }
 
 void Particle_source::write_to_file( hid_t group_id )
+{
+    Particle_source_state state = current_state();
+    write_to_file( group_id, state );
+}
+
+Particle_source_state Particle_source::current_state()
+{
+    int mpi_n_of_proc;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    Particle_source_state state;
+    int single_element = 1;
+
+    state.particles = &particles;
+
+    int n_of_particles = particles.size();
+    state.n_of_particles_at_each_process.resize( mpi_n_of_proc );
+    MPI_Allgather( &n_of_particles, single_element, MPI_INT,
+		   state.n_of_particles_at_each_process.data(), single_element, MPI_INT,
+		   PETSC_COMM_WORLD );
+
+    state.max_id = max_id;
+
+    std::stringstream rnd_gen_state;
+    rnd_gen_state << rnd_gen;
+    state.rnd_gen_state = rnd_gen_state.str();
+    int length = state.rnd_gen_state.size();
+    MPI_Allreduce( &length, &state.rnd_gen_state_length, single_element,
+		   MPI_INT, MPI_MAX, PETSC_COMM_WORLD );
+    return state;
+}
+
+void Particle_source::write_to_file( hid_t group_id, Particle_source_state &state )
 {
     std::cout << "Source name = " << name << ", "
-	      << "number of particles = " << particles.size()
+	      << "number of particles = " << state.particles->size()
 	      << std::endl;
     hid_t current_source_group_id;
     herr_t status;
@@ -183,7 +219,8 @@ void Particle_source::write_to_file( hid_t group_id )
 					 H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     hdf5_status_check( current_source_group_id );
 
-    write_hdf5_particles( current_source_group_id );
+    write_hdf5_particles( current_source_group_id, state );
+    write_hdf5_generation_state( current_source_group_id, state );
     write_hdf5_source_parameters( current_source_group_id );
 
     status = H5Gclose( current_source_group_id );
@@ -192,46 +229,42 @@ void Particle_source::write_to_file( hid_t group_id )
     return;
 }
 
-void Particle_source::write_hdf5_particles( hid_t current_source_group_id )
+void Particle_source::write_hdf5_particles( hid_t current_source_group_id,
+					    Particle_source_state &state )
 {
     int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+
+    Particle_array &particles = *state.particles;
+    int total_n_of_particles = 0;
+    int offset = 0;
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	if( proc < mpi_process_rank )
+	    offset += state.n_of_particles_at_each_process[proc];
+	total_n_of_particles += state.n_of_particles_at_each_process[proc];
+    }
     
     herr_t status;
     hid_t filespace, memspace, dset;
     hid_t plist_id;
     int rank = 1;
     hsize_t dims[rank], subset_dims[rank], subset_offset[rank];
-    dims[0] = total_particles_across_all_processes();
-
-    // todo: is it possible to get rid of this copying?
-    int *id_buf = new int[ particles.size() ];
-    double *x_buf = new double[ particles.size() ];
-    double *y_buf = new double[ particles.size() ];
-    double *z_buf = new double[ particles.size() ];
-    double *px_buf = new double[ particles.size() ];
-    double *py_buf = new double[ particles.size() ];
-    double *pz_buf = new double[ particles.size() ];
-    int *mpi_proc_buf = new int[ particles.size() ];
-    
-    for( unsigned int i = 0; i < particles.size(); i++ ){
-	id_buf[i] = particles[i].id;
-	x_buf[i] = vec3d_x( particles[i].position );
-	y_buf[i] = vec3d_y( particles[i].position );
-	z_buf[i] = vec3d_z( particles[i].position );
-	px_buf[i] = vec3d_x( particles[i].momentum );
-	py_buf[i] = vec3d_y( particles[i].momentum );
-	pz_buf[i] = vec3d_z( particles[i].momentum );
-	mpi_proc_buf[i] = mpi_process_rank;
-    }     
+    dims[0] = total_n_of_particles;
+
+    // Coordinates, momenta and ids are written directly
+    // from the particle arrays; only rank numbers need a buffer.
+    // Disk types are native, so no byte swapping is needed.
+    hid_t phase_space_disk_type =
+	single_precision_output ? H5T_NATIVE_FLOAT : H5T_NATIVE_DOUBLE;
+    std::vector<int> mpi_proc_buf( particles.size(), mpi_process_rank );
 
     plist_id = H5Pcreate( H5P_DATASET_XFER ); hdf5_status_check( plist_id );
     status = H5Pset_dxpl_mpio( plist_id, H5FD_MPIO_COLLECTIVE );
     hdf5_status_check( status );
 
     subset_dims[0] = particles.size();
-    subset_offset[0] = data_offset_for_each_process_for_1d_dataset();
+    subset_offset[0] = offset;
 
     // check is necessary for old hdf5 versions
     if ( subset_dims[0] != 0 ){	
@@ -252,130 +285,357 @@ void Particle_source::write_hdf5_particles( hid_t current_source_group_id )
 				  subset_offset, NULL, subset_dims, NULL );
     hdf5_status_check( status );
 
+    // Chunks are as large as the biggest part of a process, so each process
+    // shares at most two chunks with others during parallel compression.
+    // Particles are compressed losslessly.
+    hid_t create_plist;
+    if ( total_n_of_particles != 0 ){
+	hsize_t chunk_dims[rank];
+	chunk_dims[0] = *std::max_element( state.n_of_particles_at_each_process.begin(),
+					   state.n_of_particles_at_each_process.end() );
+	create_plist = compression.create_plist( rank, chunk_dims, false );
+    } else {
+	create_plist = H5Pcreate( H5P_DATASET_CREATE );
+	hdf5_status_check( create_plist );
+    }
     
     dset = H5Dcreate( current_source_group_id, "./particle_id",
-		      H5T_STD_I32BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      H5T_NATIVE_INT, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_INT,
-		       memspace, filespace, plist_id, id_buf );
+		       memspace, filespace, plist_id, particles.id.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
     dset = H5Dcreate( current_source_group_id, "./position_x",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      phase_space_disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id, x_buf );
+		       memspace, filespace, plist_id, particles.x.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
     dset = H5Dcreate( current_source_group_id, "./position_y",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      phase_space_disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id, y_buf );
+		       memspace, filespace, plist_id, particles.y.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
     dset = H5Dcreate( current_source_group_id, "./position_z",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      phase_space_disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id, z_buf );
+		       memspace, filespace, plist_id, particles.z.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
     
     dset = H5Dcreate( current_source_group_id, "./momentum_x",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      phase_space_disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id, px_buf );
+		       memspace, filespace, plist_id, particles.px.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
     dset = H5Dcreate( current_source_group_id, "./momentum_y",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      phase_space_disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id, py_buf );
+		       memspace, filespace, plist_id, particles.py.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
     dset = H5Dcreate( current_source_group_id, "./momentum_z",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      phase_space_disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id, pz_buf );
+		       memspace, filespace, plist_id, particles.pz.data() );
+    hdf5_status_check( status );
+    status = H5Dclose( dset ); hdf5_status_check( status );
+
+
+    dset = H5Dcreate( current_source_group_id, "./momentum_is_half_time_step_shifted",
+		      H5T_NATIVE_CHAR, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
+    hdf5_status_check( dset );
+    status = H5Dwrite( dset, H5T_NATIVE_CHAR,
+		       memspace, filespace, plist_id,
+		       particles.momentum_is_half_time_step_shifted.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
 
     dset = H5Dcreate( current_source_group_id, "./particle_mpi_proc",
-		      H5T_STD_I32BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+		      H5T_NATIVE_INT, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_INT,
-		       memspace, filespace, plist_id, mpi_proc_buf );
+		       memspace, filespace, plist_id, mpi_proc_buf.data() );
     hdf5_status_check( status );
     status = H5Dclose( dset ); hdf5_status_check( status );
 
         
+    status = H5Pclose( create_plist ); hdf5_status_check( status );
     status = H5Sclose( filespace ); hdf5_status_check( status );
     status = H5Sclose( memspace ); hdf5_status_check( status );
     status = H5Pclose( plist_id ); hdf5_status_check( status );
-
-    delete[] id_buf;
-    delete[] x_buf;
-    delete[] y_buf;
-    delete[] z_buf;
-    delete[] px_buf;
-    delete[] py_buf;
-    delete[] pz_buf;
-    delete[] mpi_proc_buf;    
 }
 
-int Particle_source::total_particles_across_all_processes()
+void Particle_source::write_hdf5_generation_state( hid_t current_source_group_id,
+						   Particle_source_state &state )
 {
-    int n_of_particles = particles.size();
-    int total_n_of_particles;
+    int mpi_n_of_proc, mpi_process_rank;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+
+    herr_t status;
     int single_element = 1;
+    std::string current_group = "./";
+
+    status = H5LTset_attribute_int( current_source_group_id, current_group.c_str(),
+				    "n_of_particles_at_each_process",
+				    state.n_of_particles_at_each_process.data(),
+				    mpi_n_of_proc );
+    hdf5_status_check( status );
+    status = H5LTset_attribute_uint( current_source_group_id, current_group.c_str(),
+				     "max_id", &state.max_id, single_element );
+    hdf5_status_check( status );
+
+    // Each process has its own random generator;
+    // its state is stored as a fixed length string, one per process.
+    hid_t filespace, memspace, dset, string_type;
+    hid_t plist_id;
+    int rank = 1;
+    hsize_t dims[rank], subset_dims[rank], subset_offset[rank];
+    dims[0] = mpi_n_of_proc;
+    subset_dims[0] = 1;
+    subset_offset[0] = mpi_process_rank;
+    std::vector<char> rnd_gen_state( state.rnd_gen_state_length, '\0' );
+    std::copy( state.rnd_gen_state.begin(), state.rnd_gen_state.end(),
+	       rnd_gen_state.begin() );
+
+    string_type = H5Tcopy( H5T_C_S1 ); hdf5_status_check( string_type );
+    status = H5Tset_size( string_type, state.rnd_gen_state_length );
+    hdf5_status_check( status );
+    plist_id = H5Pcreate( H5P_DATASET_XFER ); hdf5_status_check( plist_id );
+    status = H5Pset_dxpl_mpio( plist_id, H5FD_MPIO_COLLECTIVE );
+    hdf5_status_check( status );
+    memspace = H5Screate_simple( rank, subset_dims, NULL );
+    hdf5_status_check( memspace );
+    filespace = H5Screate_simple( rank, dims, NULL );
+    hdf5_status_check( filespace );
+    status = H5Sselect_hyperslab( filespace, H5S_SELECT_SET,
+				  subset_offset, NULL, subset_dims, NULL );
+    hdf5_status_check( status );
 
-    MPI_Allreduce( &n_of_particles, &total_n_of_particles, single_element,
-		   MPI_INT, MPI_SUM, MPI_COMM_WORLD );
+    dset = H5Dcreate( current_source_group_id, "./rnd_gen_state",
+		      string_type, filespace,
+		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+    hdf5_status_check( dset );
+    status = H5Dwrite( dset, string_type,
+		       memspace, filespace, plist_id, rnd_gen_state.data() );
+    hdf5_status_check( status );
+    status = H5Dclose( dset ); hdf5_status_check( status );
 
-    return total_n_of_particles;
+    status = H5Sclose( filespace ); hdf5_status_check( status );
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+    status = H5Tclose( string_type ); hdf5_status_check( status );
 }
 
-int Particle_source::data_offset_for_each_process_for_1d_dataset()
-{    
+void Particle_source::read_from_file( hid_t group_id )
+{
+    hid_t current_source_group_id;
+    herr_t status;
+
+    current_source_group_id = H5Gopen2( group_id, ( "./" + name ).c_str(), H5P_DEFAULT );
+    if( current_source_group_id < 0 ){
+	std::cout << "Error: particle source " << name
+		  << " is not found in file. Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    read_hdf5_particles( current_source_group_id );
+    read_hdf5_generation_state( current_source_group_id );
+
+    status = H5Gclose( current_source_group_id );
+    hdf5_status_check( status );
+}
+
+std::vector<int> Particle_source::read_hdf5_n_of_particles_at_each_process(
+    hid_t current_source_group_id )
+{
+    int mpi_n_of_proc;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    herr_t status;
+    std::string current_group = "./";
+
+    hsize_t n_of_processes_in_file;
+    H5T_class_t type_class;
+    size_t type_size;
+    status = H5LTget_attribute_info( current_source_group_id, current_group.c_str(),
+				     "n_of_particles_at_each_process",
+				     &n_of_processes_in_file, &type_class, &type_size );
+    hdf5_status_check( status );
+    if( (int)n_of_processes_in_file != mpi_n_of_proc ){
+	std::cout << "Error: file was written by " << n_of_processes_in_file
+		  << " processes; restart with the same number of processes. "
+		  << "Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+
+    std::vector<int> n_of_particles_at_each_process( mpi_n_of_proc );
+    status = H5LTget_attribute_int( current_source_group_id, current_group.c_str(),
+				    "n_of_particles_at_each_process",
+				    n_of_particles_at_each_process.data() );
+    hdf5_status_check( status );
+    return n_of_particles_at_each_process;
+}
+
+void Particle_source::read_hdf5_particles( hid_t current_source_group_id )
+{
     int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
 
+    std::vector<int> n_of_particles_at_each_process =
+	read_hdf5_n_of_particles_at_each_process( current_source_group_id );
+    int total_n_of_particles = 0;
     int offset = 0;
-    int n_of_particles = particles.size();
-    int single_element = 1;
-    int *n_of_particles_at_each_proc = new int[ mpi_n_of_proc ];
+    for( int proc = 0; proc < mpi_n_of_proc; proc++ ){
+	if( proc < mpi_process_rank )
+	    offset += n_of_particles_at_each_process[proc];
+	total_n_of_particles += n_of_particles_at_each_process[proc];
+    }
+    size_t n_of_particles = n_of_particles_at_each_process[ mpi_process_rank ];
 
-    MPI_Allgather( &n_of_particles, single_element, MPI_INT,
-		   n_of_particles_at_each_proc, single_element, MPI_INT,
-		   MPI_COMM_WORLD );
-    
-    for( int i = 1; i <= mpi_process_rank; i++ ){
-	offset = offset + n_of_particles_at_each_proc[i - 1];
+    particles.resize( n_of_particles );
+
+    herr_t status;
+    hid_t filespace, memspace;
+    hid_t plist_id;
+    int rank = 1;
+    hsize_t dims[rank], subset_dims[rank], subset_offset[rank];
+    dims[0] = total_n_of_particles;
+    subset_dims[0] = n_of_particles;
+    subset_offset[0] = offset;
+
+    plist_id = H5Pcreate( H5P_DATASET_XFER ); hdf5_status_check( plist_id );
+    status = H5Pset_dxpl_mpio( plist_id, H5FD_MPIO_COLLECTIVE );
+    hdf5_status_check( status );
+
+    // same as in write_hdf5_particles
+    if ( subset_dims[0] != 0 ){
+	memspace = H5Screate_simple( rank, subset_dims, NULL );
+    } else {
+	hsize_t max_dims[rank];
+	max_dims[0] = H5S_UNLIMITED;
+	memspace = H5Screate_simple( rank, subset_dims, max_dims );
     }
+    hdf5_status_check( memspace );
+    filespace = H5Screate_simple( rank, dims, NULL );
+    hdf5_status_check( filespace );
+    status = H5Sselect_hyperslab( filespace, H5S_SELECT_SET,
+				  subset_offset, NULL, subset_dims, NULL );
+    hdf5_status_check( status );
 
-    delete[] n_of_particles_at_each_proc;
-    
-    return offset;
+    read_hdf5_particle_dataset( current_source_group_id, "./particle_id",
+				H5T_NATIVE_INT, particles.id.data(),
+				memspace, filespace, plist_id );
+    read_hdf5_particle_dataset( current_source_group_id, "./position_x",
+				H5T_NATIVE_DOUBLE, particles.x.data(),
+				memspace, filespace, plist_id );
+    read_hdf5_particle_dataset( current_source_group_id, "./position_y",
+				H5T_NATIVE_DOUBLE, particles.y.data(),
+				memspace, filespace, plist_id );
+    read_hdf5_particle_dataset( current_source_group_id, "./position_z",
+				H5T_NATIVE_DOUBLE, particles.z.data(),
+				memspace, filespace, plist_id );
+    read_hdf5_particle_dataset( current_source_group_id, "./momentum_x",
+				H5T_NATIVE_DOUBLE, particles.px.data(),
+				memspace, filespace, plist_id );
+    read_hdf5_particle_dataset( current_source_group_id, "./momentum_y",
+				H5T_NATIVE_DOUBLE, particles.py.data(),
+				memspace, filespace, plist_id );
+    read_hdf5_particle_dataset( current_source_group_id, "./momentum_z",
+				H5T_NATIVE_DOUBLE, particles.pz.data(),
+				memspace, filespace, plist_id );
+    read_hdf5_particle_dataset( current_source_group_id,
+				"./momentum_is_half_time_step_shifted",
+				H5T_NATIVE_CHAR,
+				particles.momentum_is_half_time_step_shifted.data(),
+				memspace, filespace, plist_id );
+
+    status = H5Sclose( filespace ); hdf5_status_check( status );
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+}
+
+void Particle_source::read_hdf5_particle_dataset( hid_t current_source_group_id,
+						  const char *dataset_name,
+						  hid_t mem_type, void *values,
+						  hid_t memspace, hid_t filespace,
+						  hid_t plist_id )
+{
+    herr_t status;
+    hid_t dset;
+    dset = H5Dopen2( current_source_group_id, dataset_name, H5P_DEFAULT );
+    hdf5_status_check( dset );
+    status = H5Dread( dset, mem_type, memspace, filespace, plist_id, values );
+    hdf5_status_check( status );
+    status = H5Dclose( dset ); hdf5_status_check( status );
+}
+
+void Particle_source::read_hdf5_generation_state( hid_t current_source_group_id )
+{
+    int mpi_process_rank;
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+
+    herr_t status;
+    std::string current_group = "./";
+
+    status = H5LTget_attribute_uint( current_source_group_id, current_group.c_str(),
+				     "max_id", &max_id );
+    hdf5_status_check( status );
+
+    hid_t filespace, memspace, dset, string_type;
+    int rank = 1;
+    hsize_t subset_dims[rank], subset_offset[rank];
+    subset_dims[0] = 1;
+    subset_offset[0] = mpi_process_rank;
+
+    dset = H5Dopen2( current_source_group_id, "./rnd_gen_state", H5P_DEFAULT );
+    hdf5_status_check( dset );
+    string_type = H5Dget_type( dset ); hdf5_status_check( string_type );
+    size_t state_length = H5Tget_size( string_type );
+    filespace = H5Dget_space( dset ); hdf5_status_check( filespace );
+    status = H5Sselect_hyperslab( filespace, H5S_SELECT_SET,
+				  subset_offset, NULL, subset_dims, NULL );
+    hdf5_status_check( status );
+    memspace = H5Screate_simple( rank, subset_dims, NULL );
+    hdf5_status_check( memspace );
+
+    std::vector<char> rnd_gen_state( state_length + 1, '\0' );
+    status = H5Dread( dset, string_type, memspace, filespace, H5P_DEFAULT,
+		      rnd_gen_state.data() );
+    hdf5_status_check( status );
+    std::stringstream rnd_gen_state_stream( rnd_gen_state.data() );
+    rnd_gen_state_stream >> rnd_gen;
+
+    status = H5Sclose( filespace ); hdf5_status_check( status );
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+    status = H5Tclose( string_type ); hdf5_status_check( status );
+    status = H5Dclose( dset ); hdf5_status_check( status );
 }
 
 
@@ -406,11 +666,11 @@ void Particle_source::write_hdf5_source_parameters( hid_t current_source_group_i
     hdf5_status_check( status );
     status = H5LTset_attribute_double( current_source_group_id,
 				       current_group.c_str(),
-    				       "charge", &charge, single_element );
+    				       "charge", &particles.charge, single_element );
     hdf5_status_check( status );
     status = H5LTset_attribute_double( current_source_group_id,
 				       current_group.c_str(),
-    				       "mass", &mass, single_element );
+    				       "mass", &particles.mass, single_element );
     hdf5_status_check( status );
 }
 
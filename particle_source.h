@@ -6,21 +6,37 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <algorithm>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <hdf5.h>
 #include <hdf5_hl.h>
 #include <mpi.h>
+#include <petscsys.h>
 #include "config.h"
-#include "particle.h"
+#include "particle_array.h"
+#include "output_compression.h"
 #include "vec3d.h"
 
+// Part of a source that changes during simulation.
+// Values that require communication between processes are evaluated
+// by 'Particle_source::current_state', so the state can be written
+// without collective calls on PETSC_COMM_WORLD.
+struct Particle_source_state {
+    Particle_array *particles;
+    std::vector<int> n_of_particles_at_each_process;
+    unsigned int max_id;
+    std::string rnd_gen_state;
+    // Max length of 'rnd_gen_state' over processes
+    int rnd_gen_state_length;
+};
+
 class Particle_source{
 public:
     std::string name;
     std::string geometry_type;
-    std::vector<Particle> particles;
+    Particle_array particles;
 protected:
     int initial_number_of_particles;
     int particles_to_generate_each_step;
@@ -28,17 +44,27 @@ protected:
     // Momentum
     Vec3d mean_momentum;
     double temperature;
-    // Particle characteristics
-    double charge;
-    double mass;
     // Random number generator
     std::default_random_engine rnd_gen;
+    // Positions and momenta are written as float32
+    bool single_precision_output;
+    Output_compression compression;
+public:
+    // Distributes the rest of particles between processes;
+    // shared by all sources and has the same state at each process.
+    static std::default_random_engine rest_distribution_rnd_gen;
 public:
     Particle_source( Config &conf, Particle_source_config_part &src_conf );
     void generate_each_step();
     void update_particles_position( double dt );
     void print_particles();
     void write_to_file( hid_t hdf5_file_id );
+    // Collective
+    Particle_source_state current_state();
+    void write_to_file( hid_t hdf5_file_id, Particle_source_state &state );
+    // Restore particles and generator state written by 'write_to_file'.
+    // Number of processes has to be the same as in the run that wrote the file.
+    void read_from_file( hid_t hdf5_file_id );
     virtual ~Particle_source() {};
 protected:
     // Initialization
@@ -68,11 +94,21 @@ protected:
     void mass_gt_zero( 
 	Config &conf, Particle_source_config_part &src_conf );
     // Write to file
-    void write_hdf5_particles( hid_t current_source_group_id );
+    void write_hdf5_particles( hid_t current_source_group_id,
+			       Particle_source_state &state );
+    void write_hdf5_generation_state( hid_t current_source_group_id,
+				      Particle_source_state &state );
+    // Read from file
+    std::vector<int> read_hdf5_n_of_particles_at_each_process(
+	hid_t current_source_group_id );
+    void read_hdf5_particles( hid_t current_source_group_id );
+    void read_hdf5_particle_dataset( hid_t current_source_group_id,
+				     const char *dataset_name,
+				     hid_t mem_type, void *values,
+				     hid_t memspace, hid_t filespace, hid_t plist_id );
+    void read_hdf5_generation_state( hid_t current_source_group_id );
     virtual void write_hdf5_source_parameters( hid_t current_source_group_id );
     void hdf5_status_check( herr_t status );
-    int total_particles_across_all_processes();
-    int data_offset_for_each_process_for_1d_dataset();
 };
 
 
@@ -198,11 +234,31 @@ public:
     }
     virtual ~Particle_sources_manager() {};
     void write_to_file( hid_t hdf5_file_id )
+    {
+	std::vector<Particle_source_state> states = current_state();
+	write_to_file( hdf5_file_id, states, rest_distribution_rnd_gen_state() );
+    };
+    std::vector<Particle_source_state> current_state()
+    {
+	std::vector<Particle_source_state> states;
+	for( auto &src : sources )
+	    states.push_back( src.current_state() );
+	return states;
+    };
+    std::string rest_distribution_rnd_gen_state()
+    {
+	std::stringstream state;
+	state << Particle_source::rest_distribution_rnd_gen;
+	return state.str();
+    };
+    void write_to_file( hid_t hdf5_file_id,
+			std::vector<Particle_source_state> &states,
+			const std::string &rest_distribution_rnd_gen_state )
     {
 	hid_t group_id;
 	herr_t status;
 	int single_element = 1;
-	std::string hdf5_groupname = "/Particle_sources";
+	std::string hdf5_groupname = "./Particle_sources";
 	int n_of_sources = sources.size();
 	group_id = H5Gcreate2( hdf5_file_id, hdf5_groupname.c_str(),
 			       H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
@@ -213,13 +269,56 @@ public:
 					"number_of_sources", &n_of_sources,
 					single_element );
 	hdf5_status_check( status );
+	status = H5LTset_attribute_string( hdf5_file_id,
+					   hdf5_groupname.c_str(),
+					   "rest_distribution_rnd_gen_state",
+					   rest_distribution_rnd_gen_state.c_str() );
+	hdf5_status_check( status );
 	
-	for( auto &src : sources )
-	    src.write_to_file( group_id );
+	for( size_t i = 0; i < sources.size(); i++ )
+	    sources[i].write_to_file( group_id, states[i] );
 
 	status = H5Gclose( group_id );
 	hdf5_status_check( status );
     }; 
+    void read_from_file( hid_t hdf5_file_id )
+    {
+	hid_t group_id;
+	herr_t status;
+	std::string hdf5_groupname = "/Particle_sources";
+	int n_of_sources;
+	group_id = H5Gopen2( hdf5_file_id, hdf5_groupname.c_str(), H5P_DEFAULT );
+	hdf5_status_check( group_id );
+
+	status = H5LTget_attribute_int( hdf5_file_id, hdf5_groupname.c_str(),
+					"number_of_sources", &n_of_sources );
+	hdf5_status_check( status );
+	if( n_of_sources != (int)sources.size() ){
+	    std::cout << "Error: number of particle sources in config "
+		      << "and in file doesn't match. Aborting." << std::endl;
+	    exit( EXIT_FAILURE );
+	}
+
+	H5T_class_t type_class;
+	size_t state_length;
+	status = H5LTget_attribute_info( hdf5_file_id, hdf5_groupname.c_str(),
+					 "rest_distribution_rnd_gen_state",
+					 NULL, &type_class, &state_length );
+	hdf5_status_check( status );
+	std::vector<char> state( state_length + 1, '\0' );
+	status = H5LTget_attribute_string( hdf5_file_id, hdf5_groupname.c_str(),
+					   "rest_distribution_rnd_gen_state",
+					   state.data() );
+	hdf5_status_check( status );
+	std::stringstream state_stream( state.data() );
+	state_stream >> Particle_source::rest_distribution_rnd_gen;
+
+	for( auto &src : sources )
+	    src.read_from_file( group_id );
+
+	status = H5Gclose( group_id );
+	hdf5_status_check( status );
+    };
     void generate_each_step()
     {
 	for( auto &src : sources )
@@ -11,6 +11,133 @@ void Particle_to_mesh_map::weight_particles_charge_to_mesh(
 // Eval charge density on grid
 void Particle_to_mesh_map::weight_particles_charge_to_mesh_for_single_process( 
     Spatial_mesh &spat_mesh, Particle_sources_manager &particle_sources  )
+{
+#ifdef _OPENMP
+    if( omp_get_max_threads() > 1 ){
+	weight_particles_charge_to_mesh_threaded( spat_mesh, particle_sources );
+	return;
+    }
+#endif
+    Deposition_tile whole_mesh;
+    whole_mesh.i_min = 0;
+    whole_mesh.j_min = 0;
+    whole_mesh.k_min = 0;
+    whole_mesh.i_max = spat_mesh.x_n_nodes - 1;
+    whole_mesh.j_max = spat_mesh.y_n_nodes - 1;
+    whole_mesh.k_max = spat_mesh.z_n_nodes - 1;
+    for( auto& part_src: particle_sources.sources ) {
+	Particle_array &particles = part_src.particles;
+	weight_particles_charge_to_tile( spat_mesh, particles,
+					 0, particles.size(),
+					 whole_mesh,
+					 spat_mesh.charge_density.data() );
+    }
+    return;
+}
+
+#ifdef _OPENMP
+// Each thread deposits charge of its share of particles into a private
+// buffer, which covers only nodes touched by these particles
+// (the whole mesh in the worst case; a slab if particles are sorted).
+// Buffers are then added to the mesh density plane by plane,
+// each plane by one thread, so no atomics are required.
+void Particle_to_mesh_map::weight_particles_charge_to_mesh_threaded(
+    Spatial_mesh &spat_mesh, Particle_sources_manager &particle_sources )
+{
+    int n_of_threads_used;
+    thread_tiles.resize( omp_get_max_threads() );
+
+    #pragma omp parallel
+    {
+	int thread_num = omp_get_thread_num();
+	int n_of_threads = omp_get_num_threads();
+	Deposition_tile &tile = thread_tiles[ thread_num ];
+
+	#pragma omp single
+	n_of_threads_used = n_of_threads;
+
+	eval_tile_bounds( spat_mesh, particle_sources, thread_num, n_of_threads, tile );
+	tile.rho.assign( tile.num_elements(), 0.0 );
+	for( auto& part_src: particle_sources.sources ) {
+	    Particle_array &particles = part_src.particles;
+	    size_t first = particles.size() * thread_num / n_of_threads;
+	    size_t last = particles.size() * ( thread_num + 1 ) / n_of_threads;
+	    weight_particles_charge_to_tile( spat_mesh, particles, first, last,
+					     tile, tile.rho.data() );
+	}
+
+	#pragma omp barrier
+	#pragma omp for schedule( static )
+	for( int i = 0; i < spat_mesh.x_n_nodes; i++ ) {
+	    add_tiles_to_density_plane( spat_mesh, i, n_of_threads_used );
+	}
+    }
+    return;
+}
+
+void Particle_to_mesh_map::eval_tile_bounds(
+    Spatial_mesh &spat_mesh, Particle_sources_manager &particle_sources,
+    int thread_num, int n_of_threads, Deposition_tile &tile )
+{
+    double dx = spat_mesh.x_cell_size;
+    double dy = spat_mesh.y_cell_size;
+    double dz = spat_mesh.z_cell_size;
+    int tlf_i, tlf_j, tlf_k;
+    double tlf_x_weight, tlf_y_weight, tlf_z_weight;
+
+    // Empty tile has min > max.
+    tile.i_min = spat_mesh.x_n_nodes;
+    tile.j_min = spat_mesh.y_n_nodes;
+    tile.k_min = spat_mesh.z_n_nodes;
+    tile.i_max = tile.j_max = tile.k_max = -1;
+    for( auto& part_src: particle_sources.sources ) {
+	Particle_array &particles = part_src.particles;
+	size_t first = particles.size() * thread_num / n_of_threads;
+	size_t last = particles.size() * ( thread_num + 1 ) / n_of_threads;
+	for( size_t p = first; p < last; p++ ) {
+	    next_node_num_and_weight( particles.x[p], dx, &tlf_i, &tlf_x_weight );
+	    next_node_num_and_weight( particles.y[p], dy, &tlf_j, &tlf_y_weight );
+	    next_node_num_and_weight( particles.z[p], dz, &tlf_k, &tlf_z_weight );
+	    tile.i_min = std::min( tile.i_min, tlf_i - 1 );
+	    tile.j_min = std::min( tile.j_min, tlf_j - 1 );
+	    tile.k_min = std::min( tile.k_min, tlf_k - 1 );
+	    tile.i_max = std::max( tile.i_max, tlf_i );
+	    tile.j_max = std::max( tile.j_max, tlf_j );
+	    tile.k_max = std::max( tile.k_max, tlf_k );
+	}
+    }
+    return;
+}
+
+void Particle_to_mesh_map::add_tiles_to_density_plane(
+    Spatial_mesh &spat_mesh, int i, int n_of_threads )
+{
+    double *rho = spat_mesh.charge_density.data();
+    int ny = spat_mesh.y_n_nodes;
+    int nz = spat_mesh.z_n_nodes;
+
+    for( int t = 0; t < n_of_threads; t++ ) {
+	Deposition_tile &tile = thread_tiles[t];
+	if( i < tile.i_min || i > tile.i_max )
+	    continue;
+	for( int j = tile.j_min; j <= tile.j_max; j++ ) {
+	    double *rho_row = rho + ( (size_t)i * ny + j ) * nz;
+	    const double *tile_row = tile.rho.data() + tile.offset( i, j, tile.k_min );
+	    for( int k = tile.k_min; k <= tile.k_max; k++ ) {
+		rho_row[k] += tile_row[ k - tile.k_min ];
+	    }
+	}
+    }
+    return;
+}
+#endif
+
+// Density of the tile is stored in C order,
+// rho[0] corresponds to node ( i_min, j_min, k_min ).
+void Particle_to_mesh_map::weight_particles_charge_to_tile(
+    Spatial_mesh &spat_mesh, Particle_array &particles,
+    size_t first, size_t last,
+    Deposition_tile &tile, double *rho )
 {
     // Rewrite:
     // forall particles {
@@ -24,37 +151,39 @@ void Particle_to_mesh_map::weight_particles_charge_to_mesh_for_single_process(
     double volume_around_node = cell_volume;
     int tlf_i, tlf_j, tlf_k; // 'tlf' = 'top_left_far'
     double tlf_x_weight, tlf_y_weight, tlf_z_weight;
+    ptrdiff_t stride_i = tile.stride_i();
+    ptrdiff_t stride_j = tile.stride_j();
 
-    for( auto& part_src: particle_sources.sources ) {
-	for( auto& p : part_src.particles ) {
-	    next_node_num_and_weight( vec3d_x( p.position ), dx, &tlf_i, &tlf_x_weight );
-	    next_node_num_and_weight( vec3d_y( p.position ), dy, &tlf_j, &tlf_y_weight );
-	    next_node_num_and_weight( vec3d_z( p.position ), dz, &tlf_k, &tlf_z_weight );
-	    spat_mesh.charge_density[tlf_i][tlf_j][tlf_k] +=
-		tlf_x_weight * tlf_y_weight * tlf_z_weight
-		* p.charge / volume_around_node;
-	    spat_mesh.charge_density[tlf_i-1][tlf_j][tlf_k] +=
-		( 1.0 - tlf_x_weight ) * tlf_y_weight * tlf_z_weight
-		* p.charge / volume_around_node;
-	    spat_mesh.charge_density[tlf_i][tlf_j-1][tlf_k] +=
-		tlf_x_weight * ( 1.0 - tlf_y_weight ) * tlf_z_weight
-		* p.charge / volume_around_node;
-	    spat_mesh.charge_density[tlf_i-1][tlf_j-1][tlf_k] +=
-		( 1.0 - tlf_x_weight ) * ( 1.0 - tlf_y_weight ) * tlf_z_weight
-		* p.charge / volume_around_node;
-	    spat_mesh.charge_density[tlf_i][tlf_j][tlf_k - 1] +=
-		tlf_x_weight * tlf_y_weight * ( 1.0 - tlf_z_weight )
-		* p.charge / volume_around_node;
-	    spat_mesh.charge_density[tlf_i-1][tlf_j][tlf_k - 1] +=
-		( 1.0 - tlf_x_weight ) * tlf_y_weight * ( 1.0 - tlf_z_weight )
-		* p.charge / volume_around_node;
-	    spat_mesh.charge_density[tlf_i][tlf_j-1][tlf_k - 1] +=
-		tlf_x_weight * ( 1.0 - tlf_y_weight ) * ( 1.0 - tlf_z_weight )
-		* p.charge / volume_around_node;
-	    spat_mesh.charge_density[tlf_i-1][tlf_j-1][tlf_k - 1] +=
-		( 1.0 - tlf_x_weight ) * ( 1.0 - tlf_y_weight ) * ( 1.0 - tlf_z_weight )
-		* p.charge / volume_around_node;
-	}		
+    double charge_over_volume = particles.charge / volume_around_node;
+    for( size_t p = first; p < last; p++ ) {
+	next_node_num_and_weight( particles.x[p], dx, &tlf_i, &tlf_x_weight );
+	next_node_num_and_weight( particles.y[p], dy, &tlf_j, &tlf_y_weight );
+	next_node_num_and_weight( particles.z[p], dz, &tlf_k, &tlf_z_weight );
+	double *tlf = rho + tile.offset( tlf_i, tlf_j, tlf_k );
+	tlf[0] +=
+	    tlf_x_weight * tlf_y_weight * tlf_z_weight
+	    * charge_over_volume;
+	tlf[ - stride_i ] +=
+	    ( 1.0 - tlf_x_weight ) * tlf_y_weight * tlf_z_weight
+	    * charge_over_volume;
+	tlf[ - stride_j ] +=
+	    tlf_x_weight * ( 1.0 - tlf_y_weight ) * tlf_z_weight
+	    * charge_over_volume;
+	tlf[ - stride_i - stride_j ] +=
+	    ( 1.0 - tlf_x_weight ) * ( 1.0 - tlf_y_weight ) * tlf_z_weight
+	    * charge_over_volume;
+	tlf[ - 1 ] +=
+	    tlf_x_weight * tlf_y_weight * ( 1.0 - tlf_z_weight )
+	    * charge_over_volume;
+	tlf[ - stride_i - 1 ] +=
+	    ( 1.0 - tlf_x_weight ) * tlf_y_weight * ( 1.0 - tlf_z_weight )
+	    * charge_over_volume;
+	tlf[ - stride_j - 1 ] +=
+	    tlf_x_weight * ( 1.0 - tlf_y_weight ) * ( 1.0 - tlf_z_weight )
+	    * charge_over_volume;
+	tlf[ - stride_i - stride_j - 1 ] +=
+	    ( 1.0 - tlf_x_weight ) * ( 1.0 - tlf_y_weight ) * ( 1.0 - tlf_z_weight )
+	    * charge_over_volume;
     }
     return;
 }
@@ -66,12 +195,12 @@ void Particle_to_mesh_map::combine_charge_densities_from_all_processes(
     // at each process. 
     double *rho = spat_mesh.charge_density.data();
     int n_of_elements = spat_mesh.charge_density.num_elements();
-    MPI_Allreduce(MPI_IN_PLACE, rho, n_of_elements, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, rho, n_of_elements, MPI_DOUBLE, MPI_SUM, PETSC_COMM_WORLD);
 }
 
     
 Vec3d Particle_to_mesh_map::force_on_particle( 
-    Spatial_mesh &spat_mesh, Particle &p )
+    Spatial_mesh &spat_mesh, Particle_array &particles, size_t i )
 {
     double dx = spat_mesh.x_cell_size;
     double dy = spat_mesh.y_cell_size;
@@ -80,9 +209,9 @@ Vec3d Particle_to_mesh_map::force_on_particle(
     double tlf_x_weight, tlf_y_weight, tlf_z_weight;  
     Vec3d field_from_node, total_field, force;
     //
-    next_node_num_and_weight( vec3d_x( p.position ), dx, &tlf_i, &tlf_x_weight );
-    next_node_num_and_weight( vec3d_y( p.position ), dy, &tlf_j, &tlf_y_weight );
-    next_node_num_and_weight( vec3d_z( p.position ), dz, &tlf_k, &tlf_z_weight );
+    next_node_num_and_weight( particles.x[i], dx, &tlf_i, &tlf_x_weight );
+    next_node_num_and_weight( particles.y[i], dy, &tlf_j, &tlf_y_weight );
+    next_node_num_and_weight( particles.z[i], dz, &tlf_k, &tlf_z_weight );
     // tlf
     total_field = vec3d_zero();
     field_from_node = vec3d_times_scalar(
@@ -141,7 +270,7 @@ Vec3d Particle_to_mesh_map::force_on_particle(
     field_from_node = vec3d_times_scalar( field_from_node, 1.0 - tlf_z_weight );
     total_field = vec3d_add( total_field, field_from_node );    
     //
-    force = vec3d_times_scalar( total_field, p.charge );
+    force = vec3d_times_scalar( total_field, particles.charge );
     return force;
 }
 
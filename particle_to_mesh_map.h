@@ -1,10 +1,35 @@
+#include <vector>
+#include <algorithm>
+#include <cstddef>
 #include <mpi.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "spatial_mesh.h"
 #include "particle_source.h"
-#include "particle.h"
+#include "particle_array.h"
 #include "vec3d.h"
 
 
+// Box of mesh nodes [i_min, i_max] x [j_min, j_max] x [k_min, k_max]
+// together with charge density buffer for these nodes.
+struct Deposition_tile {
+    int i_min, j_min, k_min;
+    int i_max, j_max, k_max;
+    std::vector<double> rho;
+    ptrdiff_t stride_j() const { return k_max - k_min + 1; };
+    ptrdiff_t stride_i() const { return ( j_max - j_min + 1 ) * stride_j(); };
+    ptrdiff_t offset( int i, int j, int k ) const {
+	return ( i - i_min ) * stride_i() + ( j - j_min ) * stride_j() + ( k - k_min );
+    };
+    size_t num_elements() const {
+	if( i_max < i_min || j_max < j_min || k_max < k_min )
+	    return 0;
+	return ( i_max - i_min + 1 ) * stride_i();
+    };
+};
+
+
 class Particle_to_mesh_map {
   public: 
     Particle_to_mesh_map() {};
@@ -15,8 +40,20 @@ class Particle_to_mesh_map {
     void weight_particles_charge_to_mesh_for_single_process( Spatial_mesh &spat_mesh,
 							     Particle_sources_manager &particle_sources );
     void combine_charge_densities_from_all_processes( Spatial_mesh &spat_mesh );
-    Vec3d force_on_particle( Spatial_mesh &spat_mesh, Particle &p );
+    Vec3d force_on_particle( Spatial_mesh &spat_mesh, Particle_array &particles, size_t i );
   private:
+    // Per-thread deposition buffers, kept between time steps
+    std::vector<Deposition_tile> thread_tiles;
+    void weight_particles_charge_to_tile( Spatial_mesh &spat_mesh, Particle_array &particles,
+					  size_t first, size_t last,
+					  Deposition_tile &tile, double *rho );
+#ifdef _OPENMP
+    void weight_particles_charge_to_mesh_threaded( Spatial_mesh &spat_mesh,
+						   Particle_sources_manager &particle_sources );
+    void eval_tile_bounds( Spatial_mesh &spat_mesh, Particle_sources_manager &particle_sources,
+			   int thread_num, int n_of_threads, Deposition_tile &tile );
+    void add_tiles_to_density_plane( Spatial_mesh &spat_mesh, int i, int n_of_threads );
+#endif
     void next_node_num_and_weight( const double x, const double grid_step, 
 				   int *next_node, double *weight );
 
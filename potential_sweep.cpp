@@ -0,0 +1,214 @@
+#include "potential_sweep.h"
+
+static const char *boundary_names[] = { "boundary_phi_left", "boundary_phi_right",
+					"boundary_phi_bottom", "boundary_phi_top",
+					"boundary_phi_near", "boundary_phi_far" };
+
+Potential_sweep::Potential_sweep( Config &conf, const std::string &sweep_file,
+				  int group_num, int n_of_groups )
+{
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+    read_sweep_file( sweep_file );
+    keep_lines_of_group( group_num, n_of_groups );
+    check_electrode_names( conf );
+}
+
+//
+// Table
+//
+
+void Potential_sweep::read_sweep_file( const std::string &sweep_file )
+{
+    std::ifstream in( sweep_file );
+    check_and_exit_if_not( in.good(), "can't open sweep file '" + sweep_file + "'" );
+
+    std::string line;
+    bool header_read = false;
+    while( std::getline( in, line ) ){
+	std::istringstream fields( line );
+	std::string first;
+	if( !( fields >> first ) || first[0] == '#' )
+	    continue;
+	if( !header_read ){
+	    check_and_exit_if_not( first == "output_filename_prefix",
+				   "first column of sweep file has to be 'output_filename_prefix'" );
+	    std::string name;
+	    while( fields >> name )
+		electrode_names.push_back( name );
+	    check_and_exit_if_not( !electrode_names.empty(),
+				   "no electrodes are listed in sweep file" );
+	    header_read = true;
+	    continue;
+	}
+	std::vector<double> potentials;
+	double value;
+	while( fields >> value )
+	    potentials.push_back( value );
+	check_and_exit_if_not( fields.eof() && potentials.size() == electrode_names.size(),
+			       "wrong number of potentials in sweep file line '" + line + "'" );
+	output_prefixes.push_back( first );
+	electrode_potentials.push_back( potentials );
+    }
+    check_and_exit_if_not( !output_prefixes.empty(), "no runs are listed in sweep file" );
+}
+
+void Potential_sweep::keep_lines_of_group( int group_num, int n_of_groups )
+{
+    std::vector<std::string> group_prefixes;
+    std::vector<std::vector<double>> group_potentials;
+    for( size_t run_num = group_num; run_num < output_prefixes.size(); run_num += n_of_groups ){
+	group_prefixes.push_back( output_prefixes[run_num] );
+	group_potentials.push_back( electrode_potentials[run_num] );
+    }
+    check_and_exit_if_not( !group_prefixes.empty(),
+			   "there are more process groups than lines in sweep file" );
+    output_prefixes.swap( group_prefixes );
+    electrode_potentials.swap( group_potentials );
+}
+
+void Potential_sweep::check_electrode_names( Config &conf )
+{
+    for( auto &name : electrode_names ){
+	bool found = false;
+	for( auto &b : boundary_names )
+	    found = found || ( name == b );
+	for( auto &reg : conf.inner_regions_config_part )
+	    found = found || ( name == reg.name );
+	check_and_exit_if_not( found, "unknown electrode '" + name + "' in sweep file" );
+    }
+}
+
+//
+// Basis
+//
+
+void Potential_sweep::eval_basis_potentials( Config &conf )
+{
+    profiler.reset( new Profiler( conf ) );
+
+    // Swept electrodes grounded, others as in config
+    for( size_t e = 0; e < electrode_names.size(); e++ )
+	set_electrode_potential( conf, electrode_names[e], 0.0 );
+    eval_vacuum_potential( conf, offset_potential );
+
+    unit_potentials.resize( electrode_names.size() );
+    for( size_t e = 0; e < electrode_names.size(); e++ ){
+	set_all_electrode_potentials_to_zero( conf );
+	set_electrode_potential( conf, electrode_names[e], 1.0 );
+	eval_vacuum_potential( conf, unit_potentials[e] );
+    }
+}
+
+void Potential_sweep::eval_vacuum_potential( Config &conf,
+					     boost::multi_array<double, 3> &result )
+{
+    Spatial_mesh spat_mesh( conf );
+    Inner_regions_manager inner_regions( conf, spat_mesh );
+    if( !field_solver )
+	field_solver.reset( new Field_solver( conf, spat_mesh, inner_regions ) );
+    spat_mesh.clear_old_density_values();
+    field_solver->eval_potential( spat_mesh, inner_regions, *profiler );
+    result.resize( boost::extents[ spat_mesh.x_n_nodes ][ spat_mesh.y_n_nodes ][ spat_mesh.z_n_nodes ] );
+    result = spat_mesh.potential;
+}
+
+void Potential_sweep::set_electrode_potential( Config &conf, const std::string &name,
+					       double potential )
+{
+    Boundary_config_part &b = conf.boundary_config_part;
+    if( name == "boundary_phi_left" ) b.boundary_phi_left = potential;
+    if( name == "boundary_phi_right" ) b.boundary_phi_right = potential;
+    if( name == "boundary_phi_bottom" ) b.boundary_phi_bottom = potential;
+    if( name == "boundary_phi_top" ) b.boundary_phi_top = potential;
+    if( name == "boundary_phi_near" ) b.boundary_phi_near = potential;
+    if( name == "boundary_phi_far" ) b.boundary_phi_far = potential;
+    for( auto &reg : conf.inner_regions_config_part ){
+	if( reg.name == name )
+	    reg.potential = potential;
+    }
+}
+
+void Potential_sweep::set_all_electrode_potentials_to_zero( Config &conf )
+{
+    for( auto &b : boundary_names )
+	set_electrode_potential( conf, b, 0.0 );
+    for( auto &reg : conf.inner_regions_config_part )
+	reg.potential = 0.0;
+}
+
+//
+// Runs
+//
+
+void Potential_sweep::run( Config &conf )
+{
+    // Config is modified for each run; restored at the end.
+    Boundary_config_part initial_boundaries = conf.boundary_config_part;
+    std::vector<double> initial_region_potentials;
+    for( auto &reg : conf.inner_regions_config_part )
+	initial_region_potentials.push_back( reg.potential );
+    std::string initial_prefix = conf.output_filename_config_part.output_filename_prefix;
+    auto restore_initial_potentials = [&](){
+	conf.boundary_config_part = initial_boundaries;
+	for( size_t r = 0; r < conf.inner_regions_config_part.size(); r++ )
+	    conf.inner_regions_config_part[r].potential = initial_region_potentials[r];
+    };
+
+    eval_basis_potentials( conf );
+    restore_initial_potentials();
+
+    for( size_t run_num = 0; run_num < output_prefixes.size(); run_num++ ){
+	if( mpi_process_rank == 0 ){
+	    std::cout << "Sweep run " << run_num + 1 << " of " << output_prefixes.size()
+		      << ": " << output_prefixes[run_num] << std::endl;
+	}
+	for( size_t e = 0; e < electrode_names.size(); e++ )
+	    set_electrode_potential( conf, electrode_names[e],
+				     electrode_potentials[run_num][e] );
+	conf.output_filename_config_part.output_filename_prefix = output_prefixes[run_num];
+	// Each run starts as a separate one would.
+	Particle_source::rest_distribution_rnd_gen.seed();
+
+	Domain dom( conf );
+	dom.field_solver.take_over_setup( *field_solver );
+	superpose_vacuum_potential( run_num, dom.spat_mesh );
+	dom.field_solver.set_initial_guess_from_spat_mesh( dom.spat_mesh );
+	dom.field_solver.eval_fields_from_potential( dom.spat_mesh );
+	dom.write_fields_without_particles( conf );
+	dom.run_pic( conf );
+	field_solver->take_over_setup( dom.field_solver );
+    }
+
+    restore_initial_potentials();
+    conf.output_filename_config_part.output_filename_prefix = initial_prefix;
+}
+
+void Potential_sweep::superpose_vacuum_potential( int run_num, Spatial_mesh &spat_mesh )
+{
+    // Domain boundary nodes are already set from config; superposition
+    // would add up potentials at edges shared by two boundaries.
+    int nx = spat_mesh.x_n_nodes;
+    int ny = spat_mesh.y_n_nodes;
+    int nz = spat_mesh.z_n_nodes;
+    for( int i = 1; i < nx - 1; i++ ){
+	for( int j = 1; j < ny - 1; j++ ){
+	    for( int k = 1; k < nz - 1; k++ ){
+		double phi = offset_potential[i][j][k];
+		for( size_t e = 0; e < electrode_names.size(); e++ ){
+		    phi += electrode_potentials[run_num][e] * unit_potentials[e][i][j][k];
+		}
+		spat_mesh.potential[i][j][k] = phi;
+	    }
+	}
+    }
+}
+
+void Potential_sweep::check_and_exit_if_not( const bool &should_be, const std::string &message )
+{
+    if( !should_be ){
+	if( mpi_process_rank == 0 ){
+	    std::cout << "Error: " << message << "." << std::endl;
+	}
+	exit( EXIT_FAILURE );
+    }
+}
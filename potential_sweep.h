@@ -0,0 +1,67 @@
+#ifndef _POTENTIAL_SWEEP_H_
+#define _POTENTIAL_SWEEP_H_
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mpi.h>
+#include <boost/multi_array.hpp>
+#include "config.h"
+#include "spatial_mesh.h"
+#include "inner_region.h"
+#include "field_solver.h"
+#include "profiler.h"
+#include "domain.h"
+
+// Runs the same config for a table of electrode potentials.
+// Table is a text file; first line holds column names:
+//     output_filename_prefix  electrode_1  electrode_2 ...
+// where electrode is a name of an inner region or one of
+// boundary_phi_left, ..., boundary_phi_far; each following line
+// holds output prefix and potentials for a single run.
+// '#' starts a comment line.
+//
+// Vacuum field is linear in electrode potentials:
+//     phi = phi_0 + sum_e V_e * phi_e,
+// where phi_0 is a solution with swept electrodes grounded and
+// phi_e is a solution with unit potential at electrode 'e' and zero elsewhere.
+// These are found once, after which vacuum field of each run is
+// obtained without solving. Field solver (matrix and preconditioner
+// for PETSc) is built once and passed from one run to the next.
+// If processes are split into several groups, each group takes
+// every n_of_groups-th line of the table, starting from group_num.
+class Potential_sweep {
+  public:
+    std::vector<std::string> electrode_names;
+    std::vector<std::string> output_prefixes;
+    // electrode_potentials[run][electrode]
+    std::vector<std::vector<double>> electrode_potentials;
+  public:
+    Potential_sweep( Config &conf, const std::string &sweep_file,
+		     int group_num, int n_of_groups );
+    void run( Config &conf );
+    virtual ~Potential_sweep() {};
+  private:
+    int mpi_process_rank;
+    std::unique_ptr<Field_solver> field_solver;
+    std::unique_ptr<Profiler> profiler;
+    boost::multi_array<double, 3> offset_potential;
+    std::vector<boost::multi_array<double, 3>> unit_potentials;
+    // Table
+    void read_sweep_file( const std::string &sweep_file );
+    void keep_lines_of_group( int group_num, int n_of_groups );
+    void check_electrode_names( Config &conf );
+    // Basis
+    void eval_basis_potentials( Config &conf );
+    void eval_vacuum_potential( Config &conf, boost::multi_array<double, 3> &result );
+    void set_electrode_potential( Config &conf, const std::string &name, double potential );
+    void set_all_electrode_potentials_to_zero( Config &conf );
+    // Runs
+    void superpose_vacuum_potential( int run_num, Spatial_mesh &spat_mesh );
+    void check_and_exit_if_not( const bool &should_be, const std::string &message );
+};
+
+#endif /* _POTENTIAL_SWEEP_H_ */
@@ -0,0 +1,171 @@
+#include "profiler.h"
+
+Profiler::Profiler( Config &conf )
+{
+    write_profile_each_n_steps_ge_zero( conf );
+    write_profile_each_n_steps =
+	conf.profiling_config_part.write_profile_each_n_steps;
+    for( int phase = 0; phase < n_of_phases; phase++ ){
+	elapsed[phase] = 0.0;
+	phase_start[phase] = 0.0;
+	calls[phase] = 0;
+    }
+}
+
+bool Profiler::time_to_write( int current_time_node )
+{
+    return write_profile_each_n_steps > 0 &&
+	( current_time_node % write_profile_each_n_steps == 0 );
+}
+
+std::string Profiler::phase_name( int phase )
+{
+    switch( phase ){
+    case push: return "push";
+    case particle_removal: return "particle_removal";
+    case generation: return "generation";
+    case sorting: return "sorting";
+    case deposition: return "deposition";
+    case density_allreduce: return "density_allreduce";
+    case field_solve: return "field_solve";
+    case solution_transfer: return "solution_transfer";
+    case field_gradient: return "field_gradient";
+    case hdf5_write: return "hdf5_write";
+    }
+    return "unknown";
+}
+
+std::string Profiler::counter_name( int counter )
+{
+    switch( counter ){
+    case particles: return "particles";
+    case particle_reallocations: return "particle_reallocations";
+    case particle_storage_peak_bytes: return "particle_storage_peak_bytes";
+    }
+    return "unknown";
+}
+
+void Profiler::min_mean_max_over_processes( const double *local, int n,
+					    double *min, double *mean, double *max )
+{
+    int mpi_n_of_proc;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+
+    MPI_Allreduce( local, min, n, MPI_DOUBLE, MPI_MIN, PETSC_COMM_WORLD );
+    MPI_Allreduce( local, max, n, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD );
+    MPI_Allreduce( local, mean, n, MPI_DOUBLE, MPI_SUM, PETSC_COMM_WORLD );
+    for( int i = 0; i < n; i++ )
+	mean[i] /= mpi_n_of_proc;
+}
+
+void Profiler::print_report( const std::vector<double> &counters )
+{
+    // Phase times are followed by counters
+    const int n = n_of_phases + n_of_counters;
+    double local[n];
+    double min[n], mean[n], max[n];
+    for( int phase = 0; phase < n_of_phases; phase++ )
+	local[phase] = elapsed[phase];
+    for( int c = 0; c < n_of_counters; c++ )
+	local[n_of_phases + c] = counters[c];
+    min_mean_max_over_processes( local, n, min, mean, max );
+
+    int mpi_process_rank;
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+    if( mpi_process_rank != 0 )
+	return;
+
+    std::ios::fmtflags flags( std::cout.flags() );
+    std::streamsize precision = std::cout.precision();
+    std::cout << "### Run profile: wall time per process, s" << std::endl;
+    std::cout << std::left << std::setw(22) << "phase"
+	      << std::right << std::setw(10) << "calls"
+	      << std::setw(12) << "min"
+	      << std::setw(12) << "mean"
+	      << std::setw(12) << "max" << std::endl;
+    std::cout << std::scientific << std::setprecision(3);
+    for( int phase = 0; phase < n_of_phases; phase++ ){
+	std::cout << std::left << std::setw(22) << phase_name( phase )
+		  << std::right << std::setw(10) << calls[phase]
+		  << std::setw(12) << min[phase]
+		  << std::setw(12) << mean[phase]
+		  << std::setw(12) << max[phase] << std::endl;
+    }
+    for( int c = 0; c < n_of_counters; c++ ){
+	std::cout << std::left << std::setw(22) << counter_name( c )
+		  << std::right << std::setw(10) << ""
+		  << std::setw(12) << min[n_of_phases + c]
+		  << std::setw(12) << mean[n_of_phases + c]
+		  << std::setw(12) << max[n_of_phases + c] << std::endl;
+    }
+    std::cout.flags( flags );
+    std::cout.precision( precision );
+}
+
+std::vector<double> Profiler::summary_over_processes( const std::vector<double> &counters )
+{
+    const int n = n_of_phases + n_of_counters;
+    double local[n];
+    double min[n], mean[n], max[n];
+    for( int phase = 0; phase < n_of_phases; phase++ )
+	local[phase] = elapsed[phase];
+    for( int c = 0; c < n_of_counters; c++ )
+	local[n_of_phases + c] = counters[c];
+    min_mean_max_over_processes( local, n, min, mean, max );
+
+    std::vector<double> summary;
+    for( int i = 0; i < n; i++ ){
+	summary.push_back( min[i] );
+	summary.push_back( mean[i] );
+	summary.push_back( max[i] );
+    }
+    return summary;
+}
+
+void Profiler::write_to_file( hid_t hdf5_file_id, const std::vector<double> &summary )
+{
+    hid_t group_id;
+    herr_t status;
+    int three_elements = 3;
+    std::string hdf5_groupname = "./Profile";
+    group_id = H5Gcreate2( hdf5_file_id, hdf5_groupname.c_str(),
+			   H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT); hdf5_status_check( group_id );
+
+    // Each attribute is ( min, mean, max ) over processes;
+    // times are accumulated since start of the run.
+    for( int i = 0; i < n_of_phases + n_of_counters; i++ ){
+	std::string attr_name = ( i < n_of_phases ) ?
+	    phase_name( i ) + "_time" : counter_name( i - n_of_phases );
+	status = H5LTset_attribute_double( hdf5_file_id, hdf5_groupname.c_str(),
+					   attr_name.c_str(), &summary[3 * i], three_elements );
+	hdf5_status_check( status );
+    }
+
+    status = H5Gclose( group_id ); hdf5_status_check( status );
+    return;
+}
+
+void Profiler::write_profile_each_n_steps_ge_zero( Config &conf )
+{
+    check_and_exit_if_not(
+	conf.profiling_config_part.write_profile_each_n_steps >= 0,
+	"write_profile_each_n_steps < 0" );
+}
+
+void Profiler::check_and_exit_if_not( const bool &should_be, const std::string &message )
+{
+    if( !should_be ){
+	std::cout << "Error: " + message << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    return;
+}
+
+void Profiler::hdf5_status_check( herr_t status )
+{
+    if( status < 0 ){
+	std::cout << "Something went wrong while writing Profile group. Aborting."
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include <petscsys.h>
+#include <hdf5.h>
+#include <hdf5_hl.h>
+#include "config.h"
+
+// Wall-clock timers for phases of a time step.
+// Time is accumulated separately at each process;
+// reports give minimum, mean and maximum over processes.
+class Profiler {
+  public:
+    enum Phase { push,
+		 particle_removal,
+		 generation,
+		 sorting,
+		 deposition,
+		 density_allreduce,
+		 field_solve,
+		 solution_transfer,
+		 field_gradient,
+		 hdf5_write,
+		 n_of_phases };
+    // Per-process quantities reported along with phase times
+    enum Counter { particles,
+		   particle_reallocations,
+		   particle_storage_peak_bytes,
+		   n_of_counters };
+    int write_profile_each_n_steps;
+  public:
+    Profiler( Config &conf );
+    void start( Phase phase ) { phase_start[phase] = MPI_Wtime(); };
+    void stop( Phase phase ) {
+	elapsed[phase] += MPI_Wtime() - phase_start[phase];
+	calls[phase]++;
+    };
+    bool time_to_write( int current_time_node );
+    // 'counters' holds values of each Counter at this process.
+    void print_report( const std::vector<double> &counters );
+    // Collective: ( min, mean, max ) over processes for each phase
+    // and for each counter, as stored in the output file.
+    std::vector<double> summary_over_processes( const std::vector<double> &counters );
+    void write_to_file( hid_t hdf5_file_id, const std::vector<double> &summary );
+    virtual ~Profiler() {};
+  private:
+    double elapsed[n_of_phases];
+    double phase_start[n_of_phases];
+    long calls[n_of_phases];
+    std::string phase_name( int phase );
+    std::string counter_name( int counter );
+    void min_mean_max_over_processes( const double *local, int n,
+				      double *min, double *mean, double *max );
+    void write_profile_each_n_steps_ge_zero( Config &conf );
+    void check_and_exit_if_not( const bool &should_be, const std::string &message );
+    void hdf5_status_check( herr_t status );
+};
+
+#endif /* _PROFILER_H_ */
@@ -1,6 +1,7 @@
 #include "spatial_mesh.h"
 
-Spatial_mesh::Spatial_mesh( Config &conf )
+Spatial_mesh::Spatial_mesh( Config &conf ) :
+    compression( conf )
 {
     check_correctness_of_related_config_fields( conf );
     init_x_grid( conf );
@@ -9,6 +10,10 @@ Spatial_mesh::Spatial_mesh( Config &conf )
     allocate_ongrid_values();
     fill_node_coordinates();
     set_boundary_conditions( conf );
+    single_precision_output =
+	( conf.output_layout_config_part.output_datatype == "float32" );
+    chunked_output = compression.enabled ||
+	( conf.output_layout_config_part.output_layout == "time_series" );
 }
 
 
@@ -20,6 +25,7 @@ void Spatial_mesh::check_correctness_of_related_config_fields( Config &conf )
     grid_y_step_gt_zero_le_grid_y_size( conf );
     grid_z_size_gt_zero( conf );
     grid_z_step_gt_zero_le_grid_z_size( conf );
+    output_datatype_float64_or_float32( conf );
 }
 
 void Spatial_mesh::init_x_grid( Config &conf )
@@ -205,12 +211,155 @@ void Spatial_mesh::write_to_file( hid_t hdf5_file_id )
     hdf5_status_check( group_id );
 
     write_hdf5_attributes( group_id );
-    write_hdf5_ongrid_values( group_id );
+    write_hdf5_ongrid_values( group_id, true, true );
         
     status = H5Gclose(group_id); hdf5_status_check( status );
     return;
 }
 
+void Spatial_mesh::write_geometry_to_file( hid_t hdf5_file_id )
+{
+    hid_t group_id;
+    herr_t status;
+    std::string hdf5_groupname = "/Spatial_mesh";
+    group_id = H5Gcreate( hdf5_file_id, hdf5_groupname.c_str(),
+			  H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    hdf5_status_check( group_id );
+
+    write_hdf5_attributes( group_id );
+    write_hdf5_ongrid_values( group_id, true, false );
+        
+    status = H5Gclose(group_id); hdf5_status_check( status );
+    return;
+}
+
+void Spatial_mesh::write_to_file_linking_geometry( hid_t hdf5_file_id,
+						   const std::string &geometry_file_name )
+{
+    hid_t group_id;
+    herr_t status;
+    std::string hdf5_groupname = "/Spatial_mesh";
+    group_id = H5Gcreate( hdf5_file_id, hdf5_groupname.c_str(),
+			  H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    hdf5_status_check( group_id );
+
+    write_hdf5_attributes( group_id );
+    write_hdf5_ongrid_values( group_id, false, true );
+    link_hdf5_geometry( group_id, geometry_file_name );
+        
+    status = H5Gclose(group_id); hdf5_status_check( status );
+    return;
+}
+
+void Spatial_mesh::link_hdf5_geometry( hid_t group_id, const std::string &geometry_file_name )
+{
+    herr_t status;
+    const char *names[] = { "node_coordinates_x", "node_coordinates_y",
+			    "node_coordinates_z", "mpi_proc" };
+    for( auto &name : names ){
+	std::string target = std::string( "/Spatial_mesh/" ) + name;
+	status = H5Lcreate_external( geometry_file_name.c_str(), target.c_str(),
+				     group_id, name, H5P_DEFAULT, H5P_DEFAULT );
+	hdf5_status_check( status );
+    }
+}
+
+void Spatial_mesh::read_from_file( hid_t hdf5_file_id )
+{
+    hid_t group_id;
+    herr_t status;
+    std::string hdf5_groupname = "/Spatial_mesh";
+    group_id = H5Gopen2( hdf5_file_id, hdf5_groupname.c_str(), H5P_DEFAULT );
+    hdf5_status_check( group_id );
+
+    check_hdf5_n_of_nodes( group_id );
+    check_hdf5_dataset_extent( group_id, "./charge_density" );
+    check_hdf5_dataset_extent( group_id, "./potential" );
+    // Mesh values are the same at each process, so each one reads everything.
+    status = H5LTread_dataset_double( group_id, "./charge_density",
+				      charge_density.data() );
+    hdf5_status_check( status );
+    status = H5LTread_dataset_double( group_id, "./potential",
+				      potential.data() );
+    hdf5_status_check( status );
+    read_hdf5_vector_field( group_id, "./electric_field", electric_field );
+
+    status = H5Gclose( group_id ); hdf5_status_check( status );
+    return;
+}
+
+void Spatial_mesh::check_hdf5_n_of_nodes( hid_t group_id )
+{
+    herr_t status;
+    std::string hdf5_current_group = "./";
+    int nx, ny, nz;
+    status = H5LTget_attribute_int( group_id, hdf5_current_group.c_str(),
+				    "x_n_nodes", &nx );
+    hdf5_status_check( status );
+    status = H5LTget_attribute_int( group_id, hdf5_current_group.c_str(),
+				    "y_n_nodes", &ny );
+    hdf5_status_check( status );
+    status = H5LTget_attribute_int( group_id, hdf5_current_group.c_str(),
+				    "z_n_nodes", &nz );
+    hdf5_status_check( status );
+    if( nx != x_n_nodes || ny != y_n_nodes || nz != z_n_nodes ){
+	std::cout << "Error: spatial mesh in file doesn't match the one "
+		  << "defined in config. Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
+
+void Spatial_mesh::check_hdf5_dataset_extent( hid_t group_id, const std::string &name )
+{
+    // Time series datasets have an extra leading dimension
+    herr_t status;
+    int rank;
+    status = H5LTget_dataset_ndims( group_id, name.c_str(), &rank );
+    hdf5_status_check( status );
+    hsize_t dims[1] = { 0 };
+    if( rank == 1 ){
+	status = H5LTget_dataset_info( group_id, name.c_str(), dims, NULL, NULL );
+	hdf5_status_check( status );
+    }
+    if( rank != 1 || dims[0] != charge_density.num_elements() ){
+	std::cout << "Error: dataset " << name << " of spatial mesh in file "
+		  << "doesn't hold values of a single step for "
+		  << charge_density.num_elements() << " nodes. Aborting." << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
+
+void Spatial_mesh::read_hdf5_vector_field( hid_t group_id, const std::string &name,
+					   boost::multi_array<Vec3d, 3> &field )
+{
+    // Components are read straight into Vec3d array
+    // through strided memory dataspace.
+    hid_t memspace, dset;
+    herr_t status;
+    const int memspace_rank = 2;
+    hsize_t n = field.num_elements();
+    hsize_t mem_dims[memspace_rank] = { n, 3 };
+    hsize_t mem_count[memspace_rank] = { n, 1 };
+    const char *suffixes[] = { "_x", "_y", "_z" };
+
+    memspace = H5Screate_simple( memspace_rank, mem_dims, NULL );
+    hdf5_status_check( memspace );
+    for( int component = 0; component < 3; component++ ){
+	hsize_t mem_start[memspace_rank] = { 0, (hsize_t)component };
+	status = H5Sselect_hyperslab( memspace, H5S_SELECT_SET,
+				      mem_start, NULL, mem_count, NULL );
+	hdf5_status_check( status );
+	check_hdf5_dataset_extent( group_id, name + suffixes[component] );
+	dset = H5Dopen( group_id, ( name + suffixes[component] ).c_str(), H5P_DEFAULT );
+	hdf5_status_check( dset );
+	status = H5Dread( dset, H5T_NATIVE_DOUBLE, memspace, H5S_ALL, H5P_DEFAULT,
+			  field.data()->x );
+	hdf5_status_check( status );
+	status = H5Dclose( dset ); hdf5_status_check( status );
+    }
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+}
+
 void Spatial_mesh::write_hdf5_attributes( hid_t group_id )
 {
     herr_t status;
@@ -246,9 +395,10 @@ void Spatial_mesh::write_hdf5_attributes( hid_t group_id )
     hdf5_status_check( status );
 }
 
-void Spatial_mesh::write_hdf5_ongrid_values( hid_t group_id )
+void Spatial_mesh::write_hdf5_ongrid_values( hid_t group_id,
+					     bool write_geometry, bool write_fields )
 {   
-    hid_t filespace, memspace, dset;
+    hid_t filespace;
     hid_t plist_id;
     herr_t status;
     int rank = 1;
@@ -263,155 +413,246 @@ void Spatial_mesh::write_hdf5_ongrid_values( hid_t group_id )
     subset_dims[0] = n_of_elements_to_write_for_each_process_for_1d_dataset( dims[0] );
     subset_offset[0] = data_offset_for_each_process_for_1d_dataset( dims[0] );
 
-    // todo: remove
-    int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
-    // std::cout << "total = " << dims[0] << " "
-    // 	      << "proc_n = " << mpi_process_rank << " "
-    // 	      << "count = " << subset_dims[0] << " "
-    // 	      << "offset = " << subset_offset[0] << std::endl;
-    
-    memspace = H5Screate_simple( rank, subset_dims, NULL );
-    hdf5_status_check( memspace );
     filespace = H5Screate_simple( rank, dims, NULL );
     hdf5_status_check( filespace );
     status = H5Sselect_hyperslab( filespace, H5S_SELECT_SET,
 				  subset_offset, NULL, subset_dims, NULL );
     hdf5_status_check( status );
 
-    // todo: without compound datasets
-    // there is this copying problem.
-    double *nx = new double[ dims[0] ];
-    double *ny = new double[ dims[0] ];
-    double *nz = new double[ dims[0] ];
-    for( unsigned int i = 0; i < dims[0]; i++ ){
-	nx[i] = vec3d_x( node_coordinates.data()[i] );
-	ny[i] = vec3d_y( node_coordinates.data()[i] );
-	nz[i] = vec3d_z( node_coordinates.data()[i] );
+    hsize_t chunk_dims[rank];
+    chunk_dims[0] = chunk_length_for_1d_dataset( dims[0] );
+    hid_t field_create_plist = compression.create_plist( rank, chunk_dims, true );
+    hid_t lossless_create_plist = compression.create_plist( rank, chunk_dims, false );
+
+    // Each process passes only its own part of the arrays;
+    // components of vector fields are picked from Vec3d array
+    // by strided memory dataspace, without copying.
+    if( write_geometry ){
+	write_hdf5_vector_component( group_id, "./node_coordinates_x",
+				     H5T_NATIVE_DOUBLE, lossless_create_plist,
+				     node_coordinates, 0,
+				     filespace, subset_dims[0], subset_offset[0], plist_id );
+	write_hdf5_vector_component( group_id, "./node_coordinates_y",
+				     H5T_NATIVE_DOUBLE, lossless_create_plist,
+				     node_coordinates, 1,
+				     filespace, subset_dims[0], subset_offset[0], plist_id );
+	write_hdf5_vector_component( group_id, "./node_coordinates_z",
+				     H5T_NATIVE_DOUBLE, lossless_create_plist,
+				     node_coordinates, 2,
+				     filespace, subset_dims[0], subset_offset[0], plist_id );
+    }
+    if( write_fields ){
+	// Density values are far below 1 in CGS units and would be
+	// rounded to zero by scale-offset filter; keep it lossless.
+	write_hdf5_scalar_field( group_id, "./charge_density",
+				 field_disk_type(), lossless_create_plist,
+				 charge_density,
+				 filespace, subset_dims[0], subset_offset[0], plist_id );
+	write_hdf5_scalar_field( group_id, "./potential",
+				 field_disk_type(), field_create_plist,
+				 potential,
+				 filespace, subset_dims[0], subset_offset[0], plist_id );
+	write_hdf5_vector_component( group_id, "./electric_field_x",
+				     field_disk_type(), field_create_plist,
+				     electric_field, 0,
+				     filespace, subset_dims[0], subset_offset[0], plist_id );
+	write_hdf5_vector_component( group_id, "./electric_field_y",
+				     field_disk_type(), field_create_plist,
+				     electric_field, 1,
+				     filespace, subset_dims[0], subset_offset[0], plist_id );
+	write_hdf5_vector_component( group_id, "./electric_field_z",
+				     field_disk_type(), field_create_plist,
+				     electric_field, 2,
+				     filespace, subset_dims[0], subset_offset[0], plist_id );
     }
-    dset = H5Dcreate( group_id, "./node_coordinates_x",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-    hdf5_status_check( dset );
-    status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id,
-		       ( nx + subset_offset[0] ) );
-    hdf5_status_check( status );
-    status = H5Dclose( dset ); hdf5_status_check( status );
 
-    dset = H5Dcreate( group_id, "./node_coordinates_y",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-    hdf5_status_check( dset );
-    status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id,
-		       ( ny + subset_offset[0] ) );
-    hdf5_status_check( status );
-    status = H5Dclose( dset ); hdf5_status_check( status );
+    // for testing
+    if( write_geometry ){
+	hid_t memspace, dset;
+	int mpi_process_rank;
+	MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
+	std::vector<int> mpi_proc_ranks( subset_dims[0], mpi_process_rank );
+	memspace = H5Screate_simple( rank, subset_dims, NULL );
+	hdf5_status_check( memspace );
+	dset = H5Dcreate( group_id, "./mpi_proc",
+			  H5T_NATIVE_INT, filespace,
+			  H5P_DEFAULT, lossless_create_plist, H5P_DEFAULT );
+	hdf5_status_check( dset );
+	status = H5Dwrite( dset, H5T_NATIVE_INT,
+			   memspace, filespace, plist_id,
+			   mpi_proc_ranks.data() );
+	hdf5_status_check( status );
+	status = H5Dclose( dset ); hdf5_status_check( status );
+	status = H5Sclose( memspace ); hdf5_status_check( status );
+    }
+    //
+    
+    status = H5Pclose( field_create_plist ); hdf5_status_check( status );
+    status = H5Pclose( lossless_create_plist ); hdf5_status_check( status );
+    status = H5Sclose( filespace ); hdf5_status_check( status );
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+}
 
-    dset = H5Dcreate( group_id, "./node_coordinates_z",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+void Spatial_mesh::write_hdf5_scalar_field( hid_t group_id, const char *name,
+					    hid_t disk_type, hid_t create_plist,
+					    boost::multi_array<double, 3> &field,
+					    hid_t filespace, hsize_t count, hsize_t offset,
+					    hid_t plist_id )
+{
+    hid_t dset;
+    herr_t status;
+    dset = H5Dcreate( group_id, name,
+		      disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
-    status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id,
-		       ( nz + subset_offset[0] ) );
-    hdf5_status_check( status );
+    write_hdf5_scalar_values( dset, field, filespace, count, offset, plist_id );
     status = H5Dclose( dset ); hdf5_status_check( status );
-    delete[] nx;
-    delete[] ny;
-    delete[] nz;
+}
 
-    dset = H5Dcreate( group_id, "./charge_density",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-    hdf5_status_check( dset );
+void Spatial_mesh::write_hdf5_scalar_values( hid_t dset,
+					     boost::multi_array<double, 3> &field,
+					     hid_t filespace, hsize_t count, hsize_t offset,
+					     hid_t plist_id )
+{
+    hid_t memspace;
+    herr_t status;
+    const int rank = 1;
+    hsize_t subset_dims[rank] = { count };
+
+    memspace = H5Screate_simple( rank, subset_dims, NULL );
+    hdf5_status_check( memspace );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
 		       memspace, filespace, plist_id,
-		       ( charge_density.data() + subset_offset[0] ) );
+		       ( field.data() + offset ) );
     hdf5_status_check( status );
-    status = H5Dclose( dset ); hdf5_status_check( status );
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+}
 
-    dset = H5Dcreate( group_id, "./potential",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+void Spatial_mesh::write_hdf5_vector_component( hid_t group_id, const char *name,
+						hid_t disk_type, hid_t create_plist,
+						boost::multi_array<Vec3d, 3> &field,
+						int component,
+						hid_t filespace, hsize_t count, hsize_t offset,
+						hid_t plist_id )
+{
+    hid_t dset;
+    herr_t status;
+    dset = H5Dcreate( group_id, name,
+		      disk_type, filespace,
+		      H5P_DEFAULT, create_plist, H5P_DEFAULT );
     hdf5_status_check( dset );
-    status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id,
-		       ( potential.data() + subset_offset[0] ) );
-    hdf5_status_check( status );
+    write_hdf5_vector_component_values( dset, field, component,
+					filespace, count, offset, plist_id );
     status = H5Dclose( dset ); hdf5_status_check( status );
+}
 
+void Spatial_mesh::write_hdf5_vector_component_values( hid_t dset,
+						       boost::multi_array<Vec3d, 3> &field,
+						       int component,
+						       hid_t filespace, hsize_t count, hsize_t offset,
+						       hid_t plist_id )
+{
+    hid_t memspace;
+    herr_t status;
+    const int memspace_rank = 2;
+    // Vec3d array of this process is seen as 'count x 3' array of doubles
+    hsize_t mem_dims[memspace_rank] = { count, 3 };
+    hsize_t mem_start[memspace_rank] = { 0, (hsize_t)component };
+    hsize_t mem_count[memspace_rank] = { count, 1 };
 
-    double *ex = new double[ dims[0] ];
-    double *ey = new double[ dims[0] ];
-    double *ez = new double[ dims[0] ];
-    for( unsigned int i = 0; i < dims[0]; i++ ){
-	ex[i] = vec3d_x( electric_field.data()[i] );
-	ey[i] = vec3d_y( electric_field.data()[i] );
-	ez[i] = vec3d_z( electric_field.data()[i] );
-    }
-    dset = H5Dcreate( group_id, "./electric_field_x",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-    hdf5_status_check( dset );
-    status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id,
-		       ( ex + subset_offset[0] ) );
+    memspace = H5Screate_simple( memspace_rank, mem_dims, NULL );
+    hdf5_status_check( memspace );
+    status = H5Sselect_hyperslab( memspace, H5S_SELECT_SET,
+				  mem_start, NULL, mem_count, NULL );
     hdf5_status_check( status );
-    status = H5Dclose( dset ); hdf5_status_check( status );
-
-    dset = H5Dcreate( group_id, "./electric_field_y",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-    hdf5_status_check( dset );
     status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
 		       memspace, filespace, plist_id,
-		       ( ey + subset_offset[0] ) );
+		       ( field.data() + offset )->x );
     hdf5_status_check( status );
-    status = H5Dclose( dset ); hdf5_status_check( status );
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+}
 
-    dset = H5Dcreate( group_id, "./electric_field_z",
-		      H5T_IEEE_F64BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-    hdf5_status_check( dset );
-    status = H5Dwrite( dset, H5T_NATIVE_DOUBLE,
-		       memspace, filespace, plist_id,
-		       ( ez + subset_offset[0] ) );
+void Spatial_mesh::append_to_time_series( Time_series_output &series )
+{
+    hid_t group_id;
+    hid_t plist_id;
+    herr_t status;
+    hsize_t n = node_coordinates.num_elements();
+    hsize_t count = n_of_elements_to_write_for_each_process_for_1d_dataset( n );
+    hsize_t offset = data_offset_for_each_process_for_1d_dataset( n );
+    hsize_t chunk_length = chunk_length_for_1d_dataset( n );
+
+    // Attributes and node coordinates are written once, with the first step
+    if( series.n_of_saved_steps == 0 )
+	write_geometry_to_file( series.file_id );
+    group_id = H5Gopen2( series.file_id, "/Spatial_mesh", H5P_DEFAULT );
+    hdf5_status_check( group_id );
+
+    plist_id = H5Pcreate( H5P_DATASET_XFER );
+    hdf5_status_check( plist_id );
+    status = H5Pset_dxpl_mpio( plist_id, H5FD_MPIO_COLLECTIVE );
     hdf5_status_check( status );
-    status = H5Dclose( dset ); hdf5_status_check( status );
-    delete[] ex;
-    delete[] ey;
-    delete[] ez;
 
-    // for testing
-    int *mpi_proc_ranks = new int[ dims[0] ];
-    for( unsigned int i = 0; i < dims[0]; i++ ){
-	mpi_proc_ranks[i] = mpi_process_rank;
+    // Charge density is compressed losslessly, see write_hdf5_ongrid_values
+    const char *scalar_names[] = { "./charge_density", "./potential" };
+    boost::multi_array<double, 3> *scalar_fields[] = { &charge_density, &potential };
+    bool lossy_allowed[] = { false, true };
+    for( int i = 0; i < 2; i++ ){
+	hid_t dset = series.extended_dataset( group_id, scalar_names[i], field_disk_type(),
+					      n, chunk_length, lossy_allowed[i] );
+	hid_t filespace = time_series_row_space( dset, series.n_of_saved_steps, count, offset );
+	write_hdf5_scalar_values( dset, *scalar_fields[i], filespace, count, offset, plist_id );
+	status = H5Sclose( filespace ); hdf5_status_check( status );
+	status = H5Dclose( dset ); hdf5_status_check( status );
     }
-    dset = H5Dcreate( group_id, "./mpi_proc",
-		      H5T_STD_I32BE, filespace,
-		      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-    hdf5_status_check( dset );
-    status = H5Dwrite( dset, H5T_NATIVE_INT,
-		       memspace, filespace, plist_id,
-		       ( mpi_proc_ranks + subset_offset[0] ) );
-    hdf5_status_check( status );
-    status = H5Dclose( dset ); hdf5_status_check( status );
-    delete[] mpi_proc_ranks;
-    //
-    
-    status = H5Sclose( filespace ); hdf5_status_check( status );
-    status = H5Sclose( memspace ); hdf5_status_check( status );
+    const char *component_names[] = { "./electric_field_x", "./electric_field_y",
+				       "./electric_field_z" };
+    for( int component = 0; component < 3; component++ ){
+	hid_t dset = series.extended_dataset( group_id, component_names[component],
+					      field_disk_type(), n, chunk_length, true );
+	hid_t filespace = time_series_row_space( dset, series.n_of_saved_steps, count, offset );
+	write_hdf5_vector_component_values( dset, electric_field, component,
+					    filespace, count, offset, plist_id );
+	status = H5Sclose( filespace ); hdf5_status_check( status );
+	status = H5Dclose( dset ); hdf5_status_check( status );
+    }
+
     status = H5Pclose( plist_id ); hdf5_status_check( status );
+    status = H5Gclose( group_id ); hdf5_status_check( status );
+}
+
+hid_t Spatial_mesh::field_disk_type()
+{
+    // Native type avoids byte swapping on write and read
+    return single_precision_output ? H5T_NATIVE_FLOAT : H5T_NATIVE_DOUBLE;
+}
+
+hid_t Spatial_mesh::time_series_row_space( hid_t dset, hsize_t row,
+					   hsize_t count, hsize_t offset )
+{
+    herr_t status;
+    const int rank = 2;
+    hsize_t start[rank] = { row, offset };
+    hsize_t subset_dims[rank] = { 1, count };
+    hid_t filespace = H5Dget_space( dset );
+    hdf5_status_check( filespace );
+    status = H5Sselect_hyperslab( filespace, H5S_SELECT_SET,
+				  start, NULL, subset_dims, NULL );
+    hdf5_status_check( status );
+    return filespace;
 }
 
 int Spatial_mesh::n_of_elements_to_write_for_each_process_for_1d_dataset( int total_elements )
 {
     int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
+
+    if( chunk_aligned_distribution( total_elements ) ){
+	int chunk_length = chunk_length_for_1d_dataset( total_elements );
+	return std::min( chunk_length,
+			 total_elements - mpi_process_rank * chunk_length );
+    }
 
     int n_of_elements_for_process = total_elements / mpi_n_of_proc;
     int rest = total_elements % mpi_n_of_proc;
@@ -425,8 +666,12 @@ int Spatial_mesh::n_of_elements_to_write_for_each_process_for_1d_dataset( int to
 int Spatial_mesh::data_offset_for_each_process_for_1d_dataset( int total_elements )
 {
     int mpi_n_of_proc, mpi_process_rank;
-    MPI_Comm_size( MPI_COMM_WORLD, &mpi_n_of_proc );
-    MPI_Comm_rank( MPI_COMM_WORLD, &mpi_process_rank );    
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );    
+
+    if( chunk_aligned_distribution( total_elements ) ){
+	return mpi_process_rank * chunk_length_for_1d_dataset( total_elements );
+    }
 
     // todo: it is simpler to calclulate offset directly than
     // to perform MPI broadcast of n_of_elements_for_each_proc. 
@@ -445,6 +690,29 @@ int Spatial_mesh::data_offset_for_each_process_for_1d_dataset( int total_element
     return offset;
 }
 
+int Spatial_mesh::chunk_length_for_1d_dataset( int total_elements )
+{
+    // One chunk per process; has to agree with
+    // Time_series_output::check_chunk_size_lt_4gib
+    if( !chunked_output )
+	return total_elements;
+    int mpi_n_of_proc;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    return ( total_elements + mpi_n_of_proc - 1 ) / mpi_n_of_proc;
+}
+
+bool Spatial_mesh::chunk_aligned_distribution( int total_elements )
+{
+    // With chunked output each process writes exactly one chunk,
+    // so chunks are not shared between processes during parallel filtering.
+    // Falls back to even distribution if some process would get nothing.
+    if( !chunked_output )
+	return false;
+    int mpi_n_of_proc;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    return ( mpi_n_of_proc - 1 ) * chunk_length_for_1d_dataset( total_elements ) < total_elements;
+}
+
 void Spatial_mesh::grid_x_size_gt_zero( Config &conf )
 {
     check_and_exit_if_not( conf.mesh_config_part.grid_x_size > 0,
@@ -487,6 +755,13 @@ void Spatial_mesh::grid_z_step_gt_zero_le_grid_z_size( Config &conf )
 			   "grid_z_step < 0 or grid_z_step >= grid_z_size" );    
 }
 
+void Spatial_mesh::output_datatype_float64_or_float32( Config &conf )
+{
+    std::string datatype = conf.output_layout_config_part.output_datatype;
+    check_and_exit_if_not( datatype == "float64" || datatype == "float32",
+			   "output_datatype should be 'float64' or 'float32'" );
+}
+
 
 void Spatial_mesh::check_and_exit_if_not( const bool &should_be, const std::string &message )
 {
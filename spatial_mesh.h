@@ -5,11 +5,15 @@
 #include <stdlib.h>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <boost/multi_array.hpp>
 #include <hdf5.h>
 #include <hdf5_hl.h>
 #include <mpi.h>
+#include <petscsys.h>
 #include "config.h"
+#include "time_series_output.h"
+#include "output_compression.h"
 #include "vec3d.h"
 
 
@@ -22,12 +26,28 @@ class Spatial_mesh {
     boost::multi_array<double, 3> charge_density;
     boost::multi_array<double, 3> potential;
     boost::multi_array<Vec3d, 3> electric_field;
+  private:
+    // Charge density, potential and electric field are written as float32
+    bool single_precision_output;
+    Output_compression compression;
+    // Compressed or time series output: mesh datasets are chunked
+    bool chunked_output;
   public:
     Spatial_mesh( Config &conf );
     void clear_old_density_values();
     void set_boundary_conditions( Config &conf );
     void print();
     void write_to_file( hid_t hdf5_file_id );
+    // Node coordinates don't change during a run; they can be written
+    // once to a separate geometry file and linked from each output file.
+    void write_geometry_to_file( hid_t hdf5_file_id );
+    void write_to_file_linking_geometry( hid_t hdf5_file_id,
+					 const std::string &geometry_file_name );
+    // Add charge density, potential and electric field
+    // as the next row of time series datasets.
+    void append_to_time_series( Time_series_output &series );
+    // Restore charge density, potential and electric field.
+    void read_from_file( hid_t hdf5_file_id );
     virtual ~Spatial_mesh();
     double node_number_to_coordinate_x( int i );
     double node_number_to_coordinate_y( int j );
@@ -48,10 +68,42 @@ class Spatial_mesh {
     void print_ongrid_values();
     // write hdf5
     void write_hdf5_attributes( hid_t group_id );
-    void write_hdf5_ongrid_values( hid_t group_id );
+    void write_hdf5_ongrid_values( hid_t group_id,
+				   bool write_geometry, bool write_fields );
+    void link_hdf5_geometry( hid_t group_id, const std::string &geometry_file_name );
+    void write_hdf5_scalar_field( hid_t group_id, const char *name,
+				  hid_t disk_type, hid_t create_plist,
+				  boost::multi_array<double, 3> &field,
+				  hid_t filespace, hsize_t count, hsize_t offset,
+				  hid_t plist_id );
+    void write_hdf5_vector_component( hid_t group_id, const char *name,
+				      hid_t disk_type, hid_t create_plist,
+				      boost::multi_array<Vec3d, 3> &field,
+				      int component,
+				      hid_t filespace, hsize_t count, hsize_t offset,
+				      hid_t plist_id );
+    void write_hdf5_scalar_values( hid_t dset,
+				   boost::multi_array<double, 3> &field,
+				   hid_t filespace, hsize_t count, hsize_t offset,
+				   hid_t plist_id );
+    void write_hdf5_vector_component_values( hid_t dset,
+					     boost::multi_array<Vec3d, 3> &field,
+					     int component,
+					     hid_t filespace, hsize_t count, hsize_t offset,
+					     hid_t plist_id );
+    hid_t field_disk_type();
+    hid_t time_series_row_space( hid_t dset, hsize_t row,
+				 hsize_t count, hsize_t offset );
     int n_of_elements_to_write_for_each_process_for_1d_dataset( int total_elements );
     int data_offset_for_each_process_for_1d_dataset( int total_elements );
+    int chunk_length_for_1d_dataset( int total_elements );
+    bool chunk_aligned_distribution( int total_elements );
     void hdf5_status_check( herr_t status );
+    // read hdf5
+    void check_hdf5_n_of_nodes( hid_t group_id );
+    void check_hdf5_dataset_extent( hid_t group_id, const std::string &name );
+    void read_hdf5_vector_field( hid_t group_id, const std::string &name,
+				 boost::multi_array<Vec3d, 3> &field );
     // config check
     void grid_x_size_gt_zero( Config &conf );
     void grid_x_step_gt_zero_le_grid_x_size( Config &conf );
@@ -59,6 +111,7 @@ class Spatial_mesh {
     void grid_y_step_gt_zero_le_grid_y_size( Config &conf );
     void grid_z_size_gt_zero( Config &conf );
     void grid_z_step_gt_zero_le_grid_z_size( Config &conf );
+    void output_datatype_float64_or_float32( Config &conf );
     void check_and_exit_if_not( const bool &should_be, const std::string &message );
 };
 
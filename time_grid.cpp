@@ -107,6 +107,78 @@ void Time_grid::write_to_file( hid_t hdf5_file_id )
     return;
 }
 
+void Time_grid::append_to_time_series( Time_series_output &series )
+{
+    hid_t group_id;
+    herr_t status;
+    int single_element = 1;
+    std::string hdf5_groupname = "/Time_grid";
+    // Attributes describe the last saved step
+    if( series.n_of_saved_steps == 0 ){
+	write_to_file( series.file_id );
+    } else {
+	status = H5LTset_attribute_double( series.file_id, hdf5_groupname.c_str(),
+					   "current_time", &current_time, single_element ); hdf5_status_check( status );
+	status = H5LTset_attribute_int( series.file_id, hdf5_groupname.c_str(),
+					"current_node", &current_node, single_element ); hdf5_status_check( status );
+    }
+    group_id = H5Gopen2( series.file_id, hdf5_groupname.c_str(), H5P_DEFAULT );
+    hdf5_status_check( group_id );
+
+    append_hdf5_index_value( series, group_id, "./saved_nodes",
+			     H5T_NATIVE_INT, &current_node );
+    append_hdf5_index_value( series, group_id, "./saved_times",
+			     H5T_NATIVE_DOUBLE, &current_time );
+
+    status = H5Gclose( group_id ); hdf5_status_check( status );
+    return;
+}
+
+void Time_grid::append_hdf5_index_value( Time_series_output &series, hid_t group_id,
+					 const char *name, hid_t type, const void *value )
+{
+    hid_t dset, filespace, memspace, plist_id;
+    herr_t status;
+    const int rank = 1;
+    hsize_t row[rank] = { series.n_of_saved_steps };
+    hsize_t count[rank] = { 1 };
+    int mpi_process_rank;
+    MPI_Comm_rank( PETSC_COMM_WORLD, &mpi_process_rank );
+
+    dset = series.extended_dataset( group_id, name, type, 0, 0, false );
+    filespace = H5Dget_space( dset ); hdf5_status_check( filespace );
+    memspace = H5Screate_simple( rank, count, NULL ); hdf5_status_check( memspace );
+    // Value is the same at each process; only the first one writes it.
+    if( mpi_process_rank == 0 ){
+	status = H5Sselect_hyperslab( filespace, H5S_SELECT_SET,
+				      row, NULL, count, NULL ); hdf5_status_check( status );
+    } else {
+	status = H5Sselect_none( filespace ); hdf5_status_check( status );
+	status = H5Sselect_none( memspace ); hdf5_status_check( status );
+    }
+    plist_id = H5Pcreate( H5P_DATASET_XFER ); hdf5_status_check( plist_id );
+    status = H5Pset_dxpl_mpio( plist_id, H5FD_MPIO_COLLECTIVE ); hdf5_status_check( status );
+    status = H5Dwrite( dset, type, memspace, filespace, plist_id, value );
+    hdf5_status_check( status );
+
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+    status = H5Sclose( memspace ); hdf5_status_check( status );
+    status = H5Sclose( filespace ); hdf5_status_check( status );
+    status = H5Dclose( dset ); hdf5_status_check( status );
+}
+
+void Time_grid::read_from_file( hid_t hdf5_file_id )
+{
+    herr_t status;
+    std::string hdf5_groupname = "/Time_grid";
+
+    status = H5LTget_attribute_double( hdf5_file_id, hdf5_groupname.c_str(),
+				       "current_time", &current_time ); hdf5_status_check( status );
+    status = H5LTget_attribute_int( hdf5_file_id, hdf5_groupname.c_str(),
+				    "current_node", &current_node ); hdf5_status_check( status );
+    return;
+}
+
 void Time_grid::hdf5_status_check( herr_t status )
 {
     if( status < 0 ){
@@ -7,7 +7,9 @@
 #include <mpi.h>
 #include <hdf5.h>
 #include <hdf5_hl.h>
+#include <petscsys.h>
 #include "config.h"
+#include "time_series_output.h"
 
 class Time_grid {
   public:
@@ -20,6 +22,11 @@ class Time_grid {
     void update_to_next_step();
     void print();
     void write_to_file( hid_t hdf5_file_id );
+    // Add current node and time to the step index of time series file.
+    void append_to_time_series( Time_series_output &series );
+    // Current time and node are taken from file,
+    // other parameters are still determined by config.
+    void read_from_file( hid_t hdf5_file_id );
   private:
     // initialisation
     void check_correctness_of_related_config_fields( Config &conf );
@@ -34,6 +41,8 @@ class Time_grid {
     void time_save_step_ge_time_step_size( Config &conf );
     void check_and_exit_if_not( const bool &should_be, const std::string &message );
     // write to file
+    void append_hdf5_index_value( Time_series_output &series, hid_t group_id,
+				  const char *name, hid_t type, const void *value );
     void hdf5_status_check( herr_t status );
 }; 
 
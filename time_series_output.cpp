@@ -0,0 +1,191 @@
+#include "time_series_output.h"
+
+Time_series_output::Time_series_output( Config &conf ) :
+    enabled( conf.output_layout_config_part.output_layout == "time_series" ),
+    chunk_steps( conf.output_layout_config_part.time_series_chunk_steps ),
+    chunk_cache_size( conf.output_layout_config_part.time_series_chunk_cache_size ),
+    file_id( -1 ),
+    n_of_saved_steps( 0 ),
+    compression( conf )
+{
+    check_correctness_of_related_config_fields( conf );
+    file_name = conf.output_filename_config_part.output_filename_prefix +
+	"time_series" +
+	conf.output_filename_config_part.output_filename_suffix;
+}
+
+void Time_series_output::check_correctness_of_related_config_fields( Config &conf )
+{
+    check_and_exit_if_not(
+	conf.output_layout_config_part.time_series_chunk_steps >= 1,
+	"time_series_chunk_steps < 1" );
+    check_and_exit_if_not(
+	conf.output_layout_config_part.time_series_chunk_cache_size >= 0,
+	"time_series_chunk_cache_size < 0" );
+    if( enabled )
+	check_chunk_size_lt_4gib( conf );
+}
+
+void Time_series_output::check_chunk_size_lt_4gib( Config &conf )
+{
+    // Mesh datasets are chunked by 'time_series_chunk_steps' rows
+    // and by the part of a row written by one process ( see Spatial_mesh ).
+    int mpi_n_of_proc;
+    MPI_Comm_size( PETSC_COMM_WORLD, &mpi_n_of_proc );
+    hsize_t x_n_nodes =
+	ceil( conf.mesh_config_part.grid_x_size / conf.mesh_config_part.grid_x_step ) + 1;
+    hsize_t y_n_nodes =
+	ceil( conf.mesh_config_part.grid_y_size / conf.mesh_config_part.grid_y_step ) + 1;
+    hsize_t z_n_nodes =
+	ceil( conf.mesh_config_part.grid_z_size / conf.mesh_config_part.grid_z_step ) + 1;
+    hsize_t n_of_nodes = x_n_nodes * y_n_nodes * z_n_nodes;
+    hsize_t chunk_row_length = ( n_of_nodes + mpi_n_of_proc - 1 ) / mpi_n_of_proc;
+    hsize_t chunk_bytes = chunk_steps * chunk_row_length * sizeof( double );
+    const hsize_t max_chunk_bytes = 4ull * 1024 * 1024 * 1024;
+    check_and_exit_if_not(
+	chunk_bytes < max_chunk_bytes,
+	"chunk of time series mesh datasets exceeds 4 GiB; "
+	"decrease time_series_chunk_steps or use more processes" );
+}
+
+bool Time_series_output::is_open()
+{
+    return file_id >= 0;
+}
+
+void Time_series_output::check_file_does_not_exist()
+{
+    std::ifstream existing_file( file_name.c_str() );
+    check_and_exit_if_not(
+	!existing_file.good(),
+	"time series file '" + file_name + "' already exists and would be "
+	"overwritten; move it or change 'output_filename_prefix' before restart" );
+}
+
+void Time_series_output::create( MPI_Comm comm )
+{
+    herr_t status;
+
+    hid_t plist_id;
+    plist_id = H5Pcreate( H5P_FILE_ACCESS ); hdf5_status_check( plist_id );
+    status = H5Pset_fapl_mpio( plist_id, comm, MPI_INFO_NULL ); hdf5_status_check( status );
+
+    file_id = H5Fcreate( file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id );
+    if ( file_id < 0 ) {
+	std::cout << "Error: can't open file \'"
+		  << file_name
+		  << "\' to save results of simulation!"
+		  << std::endl;
+	std::cout << "Recheck \'output_filename_prefix\' key in config file."
+		  << std::endl;
+	std::cout << "Make sure the directory you want to save to exists."
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    status = H5Pclose( plist_id ); hdf5_status_check( status );
+
+    hid_t steps_group_id = H5Gcreate( file_id, "/Steps",
+				      H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+    hdf5_status_check( steps_group_id );
+    status = H5Gclose( steps_group_id ); hdf5_status_check( status );
+
+    n_of_saved_steps = 0;
+    return;
+}
+
+hid_t Time_series_output::create_step_group( int time_node )
+{
+    std::stringstream group_name;
+    group_name << "/Steps/" << std::setfill('0') << std::setw(7) << time_node;
+    hid_t group_id = H5Gcreate( file_id, group_name.str().c_str(),
+				H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+    hdf5_status_check( group_id );
+    return group_id;
+}
+
+void Time_series_output::finish_step()
+{
+    herr_t status;
+    n_of_saved_steps++;
+    // Saved steps stay readable if the run is interrupted
+    status = H5Fflush( file_id, H5F_SCOPE_GLOBAL ); hdf5_status_check( status );
+}
+
+hid_t Time_series_output::extended_dataset( hid_t group_id, const char *name,
+					    hid_t disk_type, hsize_t row_length,
+					    hsize_t chunk_row_length, bool lossy_allowed )
+{
+    hid_t dset;
+    herr_t status;
+    const int rank = ( row_length == 0 ) ? 1 : 2;
+    hsize_t dims[2] = { n_of_saved_steps + 1, row_length };
+
+    // By default the cache holds exactly one chunk
+    size_t cache_size = chunk_cache_size;
+    if( cache_size == 0 )
+	cache_size = chunk_steps * std::max( chunk_row_length, (hsize_t)1 ) *
+	    H5Tget_size( disk_type );
+    hid_t access_plist = H5Pcreate( H5P_DATASET_ACCESS );
+    hdf5_status_check( access_plist );
+    status = H5Pset_chunk_cache( access_plist, H5D_CHUNK_CACHE_NSLOTS_DEFAULT,
+				 cache_size, H5D_CHUNK_CACHE_W0_DEFAULT );
+    hdf5_status_check( status );
+
+    if( n_of_saved_steps == 0 ){
+	hsize_t max_dims[2] = { H5S_UNLIMITED, row_length };
+	hsize_t chunk_dims[2] = { chunk_steps, chunk_row_length };
+	hid_t filespace = H5Screate_simple( rank, dims, max_dims );
+	hdf5_status_check( filespace );
+	hid_t create_plist = H5Pcreate( H5P_DATASET_CREATE );
+	hdf5_status_check( create_plist );
+	status = H5Pset_chunk( create_plist, rank, chunk_dims ); hdf5_status_check( status );
+	compression.set_filters( create_plist, lossy_allowed );
+	// Each row is written completely, so there is no need to prefill chunks.
+	status = H5Pset_fill_time( create_plist, H5D_FILL_TIME_NEVER ); hdf5_status_check( status );
+	dset = H5Dcreate( group_id, name, disk_type, filespace,
+			  H5P_DEFAULT, create_plist, access_plist );
+	hdf5_status_check( dset );
+	status = H5Pclose( create_plist ); hdf5_status_check( status );
+	status = H5Sclose( filespace ); hdf5_status_check( status );
+    } else {
+	dset = H5Dopen( group_id, name, access_plist );
+	hdf5_status_check( dset );
+	status = H5Dset_extent( dset, dims ); hdf5_status_check( status );
+    }
+
+    status = H5Pclose( access_plist ); hdf5_status_check( status );
+    return dset;
+}
+
+void Time_series_output::close()
+{
+    herr_t status;
+    if( !is_open() )
+	return;
+    status = H5Fclose( file_id ); hdf5_status_check( status );
+    file_id = -1;
+}
+
+Time_series_output::~Time_series_output()
+{
+    close();
+}
+
+void Time_series_output::check_and_exit_if_not( const bool &should_be, const std::string &message )
+{
+    if( !should_be ){
+	std::cout << "Error: " + message << std::endl;
+	exit( EXIT_FAILURE );
+    }
+    return;
+}
+
+void Time_series_output::hdf5_status_check( herr_t status )
+{
+    if( status < 0 ){
+	std::cout << "Something went wrong while writing time series file "
+		  << file_name << ". Aborting."
+		  << std::endl;
+	exit( EXIT_FAILURE );
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef _TIME_SERIES_OUTPUT_H_
+#define _TIME_SERIES_OUTPUT_H_
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <mpi.h>
+#include <hdf5.h>
+#include <hdf5_hl.h>
+#include "config.h"
+#include "output_compression.h"
+
+// 'time_series' output layout: all saved steps go into a single file
+// instead of a new file per step.
+// Mesh fields are stored as chunked datasets with time as the leading,
+// extendible dimension; '/Time_grid/saved_nodes' and '/Time_grid/saved_times'
+// give time node and time of each row.
+// Particles, inner regions and profile vary in size and are written
+// into a separate group '/Steps/<time node>' for each step.
+// The file is kept open between steps and is closed in destructor.
+class Time_series_output {
+  public:
+    bool enabled;
+    std::string file_name;
+    hsize_t chunk_steps;
+    size_t chunk_cache_size;
+    hid_t file_id;
+    // Row of the current step in extendible datasets
+    hsize_t n_of_saved_steps;
+    Output_compression compression;
+  public:
+    Time_series_output( Config &conf );
+    bool is_open();
+    // Restarted run would overwrite series of the previous one
+    void check_file_does_not_exist();
+    void create( MPI_Comm comm );
+    hid_t create_step_group( int time_node );
+    void finish_step();
+    // Dataset 'name' with 'row_length' elements per step
+    // ( one element per step if 'row_length' is 0 ),
+    // created at the first step and extended by one row at the next ones.
+    // Rows are split into chunks of 'chunk_row_length' elements;
+    // chunk cache holds one chunk unless 'chunk_cache_size' is given.
+    hid_t extended_dataset( hid_t group_id, const char *name,
+			    hid_t disk_type, hsize_t row_length,
+			    hsize_t chunk_row_length, bool lossy_allowed );
+    void close();
+    virtual ~Time_series_output();
+  private:
+    void check_correctness_of_related_config_fields( Config &conf );
+    void check_chunk_size_lt_4gib( Config &conf );
+    void check_and_exit_if_not( const bool &should_be, const std::string &message );
+    void hdf5_status_check( herr_t status );
+};
+
+#endif /* _TIME_SERIES_OUTPUT_H_ */